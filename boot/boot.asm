@@ -1,6 +1,18 @@
 [org 0x7c00]
-KERNEL_OFFSET equ 0x1000                        ; This is memory offset where we will load our kernel
+KERNEL_OFFSET equ 0x10000                       ; This is memory offset where we will load our kernel
+KERNEL_SEGMENT equ KERNEL_OFFSET >> 4           ; Real-mode segment of KERNEL_OFFSET (loaded at offset 0)
 
+%ifndef KERNEL_SECTORS
+%error "KERNEL_SECTORS must be passed by the build (-D KERNEL_SECTORS=n)"
+%endif
+
+%include "boot/boot_info.asm"
+
+; ==========================================================
+; Stage 1 - the 512-byte boot sector
+; Loads stage 2 (the sectors right after the boot sector) to
+; 0x7E00 with a single CHS read and jumps into it.
+; ==========================================================
     mov [ BOOT_DRIVE ] , dl                     ; BIOS stores our boot drive in DL , so it ’s
                                                 ; best to remember this for later.
     xor ax, ax
@@ -11,39 +23,96 @@ KERNEL_OFFSET equ 0x1000                        ; This is memory offset where we
     mov sp, bp
     cld
 
+    mov di, BOOT_INFO                           ; Start from an empty handoff area
+    mov cx, BOOT_INFO_SIZE / 2
+    rep stosw                                   ; AX is still 0
+    mov dword [BOOT_INFO], BOOT_INFO_MAGIC
+    boot_tsc_stamp BOOT_STAGE_ENTRY
+
     mov bx, MSG_REAL_MODE
     call print_string
 
+    mov bx, stage2_start                        ; Stage 2 directly follows the boot sector on disk
+    mov dh, STAGE2_SECTORS                      ; and in memory (0x7C00 + 512 = 0x7E00)
+    mov dl, [BOOT_DRIVE]
+    call disk_load
+
+    jmp stage2_start
+
+%include "boot/print_string.asm"
+%include "boot/disk_load.asm"
+
+; Global variables
+BOOT_DRIVE              db 0
+MSG_REAL_MODE           db "Started in 16-bit Real mode", 0
+
+; Bootsector padding
+times 510-($-$$) db 0
+dw 0xAA55
+
+; ==========================================================
+; Stage 2
+; Collects the memory map, loads the kernel, switches to
+; protected mode and jumps to KERNEL_OFFSET.
+; ==========================================================
+stage2_start:
+    call enable_a20
+    call detect_memory
+%ifdef BOOT_CMDLINE
+    mov si, boot_cmdline
+    mov di, BOOT_INFO_CMDLINE
+    mov cx, BOOT_CMDLINE_MAX
+    rep movsb
+%endif
+
     call load_kernel
+    boot_tsc_stamp BOOT_STAGE_DISK_LOADED
+
+%ifdef VBE_WIDTH
+    call vbe_set_mode                           ; Last BIOS call: the screen is graphical from here on
+%endif
 
     call switch_to_pm
 
     jmp $
 
-%include "boot/print_string.asm"
 %include "boot/print_string_pm.asm"
 %include "boot/gdt.asm"
 %include "boot/switch_to_pm.asm"
-%include "boot/disk_load.asm"
+%include "boot/disk_read.asm"
+%include "boot/detect_memory.asm"
+%include "boot/enable_a20.asm"
 %include "boot/load_kernel.asm"
+%ifdef VBE_WIDTH
+%include "boot/vbe.asm"
+%endif
 
 [bits 32]
 ; This is our start position after switiching and initializing protected mode
 BEGIN_PM:
+    boot_tsc_stamp BOOT_STAGE_PROTECTED_MODE
 
     mov ebx, MSG_PROTECTED_MODE
     call print_string_pm
 
+    mov eax, BOOT_INFO_MAGIC                    ; Identify ourselves to _start (Multiboot loaders pass 0x2BADB002)
+    mov ebx, BOOT_INFO
     call KERNEL_OFFSET
 
     jmp $
 
-; Global variables
-BOOT_DRIVE              db 0
-MSG_REAL_MODE           db "Started in 16-bit Real mode", 0
 MSG_PROTECTED_MODE      db "Successfully started 32-bit protected mode", 0
 
-; Bootsector padding
-times 510-($-$$) db 0
-dw 0xAA55
+%ifdef BOOT_CMDLINE
+; Command line built in by the Makefile (make CMDLINE=...); too long fails the build
+boot_cmdline            db BOOT_CMDLINE, 0
+times BOOT_CMDLINE_MAX - ($ - boot_cmdline) db 0
+%endif
+
+; Stage 2 padding - round up to a whole number of sectors
+times (512 - (($ - stage2_start) % 512)) % 512 db 0
+stage2_end:
+
+STAGE2_SECTORS equ (stage2_end - stage2_start) / 512
+KERNEL_LBA     equ 1 + STAGE2_SECTORS           ; Kernel sectors follow stage 2 on disk
 
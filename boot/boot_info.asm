@@ -0,0 +1,41 @@
+; ==========================================================
+; Boot information handed from the boot loader to the kernel
+; Layout must match boot_info_t in kernel/boot_info.h
+; ==========================================================
+
+BOOT_INFO               equ 0x0500              ; Free conventional memory right after the BIOS data area
+BOOT_INFO_MAGIC         equ 0x534f424c          ; "LBOS"
+BOOT_INFO_SOURCE        equ BOOT_INFO + 4       ; boot_source_t (0 = boot sector)
+BOOT_INFO_TSC           equ BOOT_INFO + 8       ; uint64_t tsc[BOOT_STAGE_MAX]
+BOOT_INFO_CMDLINE       equ BOOT_INFO + 136     ; char cmdline[BOOT_CMDLINE_MAX]
+BOOT_INFO_MMAP_COUNT    equ BOOT_INFO + 264     ; uint32_t mmap_count
+BOOT_INFO_MMAP          equ BOOT_INFO + 272     ; boot_mmap_entry_t mmap[BOOT_MMAP_MAX]
+BOOT_MMAP_ENTRY_SIZE    equ 24
+BOOT_MMAP_MAX           equ 32
+BOOT_INFO_FB            equ BOOT_INFO_MMAP + BOOT_MMAP_ENTRY_SIZE * BOOT_MMAP_MAX
+BOOT_INFO_FB_ADDR       equ BOOT_INFO_FB + 0    ; uint32_t fb_addr, 0 = text mode
+BOOT_INFO_FB_PITCH      equ BOOT_INFO_FB + 4    ; uint32_t fb_pitch (bytes per scan line)
+BOOT_INFO_FB_WIDTH      equ BOOT_INFO_FB + 8    ; uint32_t fb_width
+BOOT_INFO_FB_HEIGHT     equ BOOT_INFO_FB + 12   ; uint32_t fb_height
+BOOT_INFO_FB_BPP        equ BOOT_INFO_FB + 16   ; uint32_t fb_bpp
+BOOT_INFO_FONT          equ BOOT_INFO_FB + 20   ; uint32_t font_addr (BIOS 8x16 font)
+BOOT_INFO_SIZE          equ BOOT_INFO_FB + 24 - BOOT_INFO
+BOOT_CMDLINE_MAX        equ 128
+
+; Boot stages timestamped by the loader (see boot_stage_t)
+BOOT_STAGE_ENTRY            equ 0
+BOOT_STAGE_DISK_LOADED      equ 1
+BOOT_STAGE_PROTECTED_MODE   equ 2
+BOOT_STAGE_DECOMPRESSED     equ 3               ; Only with a compressed kernel (boot/decompress.asm)
+
+; ==========================================================
+; boot_tsc_stamp
+; Stores the current time stamp counter for a boot stage
+; Input: %1 = boot stage index
+; Clobbers: EAX, EDX
+; ==========================================================
+%macro boot_tsc_stamp 1
+    rdtsc
+    mov [BOOT_INFO_TSC + (%1) * 8], eax
+    mov [BOOT_INFO_TSC + (%1) * 8 + 4], edx
+%endmacro
@@ -0,0 +1,143 @@
+; ==========================================================
+; LZ4 kernel decompression stub (make COMPRESS=1)
+;
+; The boot loader loads this image at KERNEL_OFFSET and calls it
+; exactly like an uncompressed kernel.bin. Because the kernel
+; expands onto the very addresses the stub occupies, the stub first
+; moves its decompressor and the compressed payload above 1 MiB,
+; then expands the kernel to its link address and jumps to _start
+; with the loader's EAX/EBX untouched.
+;
+; Payload format: LZ4 legacy frame (`lz4 -l`) - a magic word
+; followed by blocks, each prefixed with its compressed size.
+; ==========================================================
+[bits 32]
+
+KERNEL_OFFSET       equ 0x10000                 ; Must match boot/boot.asm and linker.ld
+STUB_RELOC          equ 0x100000                ; Decompressor runs from here, clear of any kernel size
+LZ4_LEGACY_MAGIC    equ 0x184c2102
+
+%ifndef KERNEL_PAYLOAD
+%error "KERNEL_PAYLOAD must name the lz4 -l compressed kernel (-D KERNEL_PAYLOAD='\"file\"')"
+%endif
+
+%include "boot/boot_info.asm"
+
+[org KERNEL_OFFSET]
+
+section .text
+
+stub_start:
+    push eax                                    ; Loader magic and info pointer for _start
+    push ebx
+
+    in al, 0x92                                 ; Fast A20 gate, so STUB_RELOC is not aliased to 0
+    or al, 0x02
+    and al, 0xfe                                ; Bit 0 would reset the CPU
+    out 0x92, al
+
+    mov esi, section.reloc.start                ; Move decompressor + payload out of the way
+    mov edi, STUB_RELOC
+    mov ecx, payload_end - decompress
+    cld
+    rep movsb
+
+    mov eax, decompress
+    jmp eax
+
+section reloc follows=.text vstart=STUB_RELOC
+
+decompress:
+    mov esi, payload
+    mov edi, KERNEL_OFFSET
+    lodsd
+    cmp eax, LZ4_LEGACY_MAGIC
+    jne lz4_error
+
+.next_block:
+    cmp esi, payload_end
+    jae .done
+    lodsd                                       ; Compressed block size
+    lea edx, [esi + eax]                        ; EDX = end of this block
+    call lz4_block
+    jmp .next_block
+
+.done:
+    boot_tsc_stamp BOOT_STAGE_DECOMPRESSED
+
+    pop ebx
+    pop eax
+    jmp KERNEL_OFFSET
+
+; ==========================================================
+; lz4_block
+; Decodes one LZ4 block
+; Input: ESI = compressed data, EDX = end of compressed data,
+;        EDI = output
+; Output: ESI = EDX, EDI = end of output
+; ==========================================================
+lz4_block:
+.sequence:
+    xor eax, eax
+    lodsb                                       ; Token: literal length (high nibble), match length (low nibble)
+    mov ebx, eax
+    shr eax, 4
+    call lz4_length
+    mov ecx, eax
+    rep movsb                                   ; Copy literals
+
+    cmp esi, edx                                ; The last sequence carries literals only
+    jae .block_done
+
+    xor eax, eax
+    lodsw                                       ; Match offset back from the output pointer
+    push eax
+    mov eax, ebx
+    and eax, 0x0f
+    call lz4_length
+    lea ecx, [eax + 4]                          ; Minimum match is 4 bytes
+    pop eax
+
+    push esi
+    mov esi, edi
+    sub esi, eax
+    rep movsb                                   ; Byte copy handles overlapping matches (offset < length)
+    pop esi
+    jmp .sequence
+
+.block_done:
+    ret
+
+; ==========================================================
+; lz4_length
+; Extends a 4-bit length with the 255-terminated byte run that
+; follows it when the nibble is saturated (15)
+; Input: EAX = nibble, ESI = compressed data
+; Output: EAX = full length, ESI advanced
+; Clobbers: ECX
+; ==========================================================
+lz4_length:
+    cmp eax, 15
+    jne .done
+.more:
+    movzx ecx, byte [esi]
+    inc esi
+    add eax, ecx
+    cmp ecx, 255
+    je .more
+.done:
+    ret
+
+lz4_error:
+    mov ebx, MSG_LZ4_ERROR
+    call print_string_pm
+    jmp $
+
+%include "boot/print_string_pm.asm"
+
+MSG_LZ4_ERROR   db "Kernel decompression failed: bad LZ4 payload", 0
+
+align 4
+payload:
+    incbin KERNEL_PAYLOAD
+payload_end:
@@ -0,0 +1,42 @@
+; ==========================================================
+; detect_memory
+; Collects the BIOS E820 memory map into BOOT_INFO_MMAP and
+; stores the number of entries in BOOT_INFO_MMAP_COUNT.
+; Leaves the count at 0 if the BIOS doesn't support E820.
+; ==========================================================
+[bits 16]
+
+E820_SIGNATURE equ 0x534d4150                   ; "SMAP"
+
+detect_memory:
+    pushad
+
+    xor ebx, ebx                                ; Continuation value, 0 = start of map
+    mov di, BOOT_INFO_MMAP                      ; ES:DI = entry buffer (ES is 0)
+
+.next_entry:
+    mov dword [di + 20], 1                      ; ACPI 3.0 "valid" bit, for BIOSes that return 20 bytes
+    mov eax, 0xe820
+    mov ecx, BOOT_MMAP_ENTRY_SIZE
+    mov edx, E820_SIGNATURE
+    int 0x15
+    jc .done                                    ; Unsupported, or already past the last entry
+    cmp eax, E820_SIGNATURE
+    jne .done
+
+    mov ecx, [di + 8]                           ; Skip empty regions
+    or ecx, [di + 12]
+    jz .skip_entry
+
+    inc dword [BOOT_INFO_MMAP_COUNT]
+    add di, BOOT_MMAP_ENTRY_SIZE
+    cmp dword [BOOT_INFO_MMAP_COUNT], BOOT_MMAP_MAX
+    jae .done
+
+.skip_entry:
+    test ebx, ebx                               ; EBX = 0 after the last entry
+    jnz .next_entry
+
+.done:
+    popad
+    ret
@@ -1,5 +1,7 @@
 ; ==========================================================
 ; load DH sectors to ES:BX from drive DL
+; Reads from cylinder 0, head 0, starting at the sector right
+; after the boot sector. Used by stage 1 to pull in stage 2.
 ; Input: DH = number of sectors to read
 ; ==========================================================
 
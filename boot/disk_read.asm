@@ -0,0 +1,163 @@
+; ==========================================================
+; Stage 2 disk access
+; Uses INT 13h extensions (AH=42h, Disk Address Packet) when
+; the BIOS supports them, otherwise multi-sector CHS reads
+; (AH=02h) using the drive geometry reported by AH=08h.
+; ==========================================================
+[bits 16]
+
+DISK_MAX_CHUNK equ 127                          ; Largest transfer every EDD BIOS accepts in one call
+
+; ==========================================================
+; disk_init
+; Probes drive [BOOT_DRIVE] for INT 13h extensions and, if they
+; are missing, reads the CHS geometry for disk_read.
+; ==========================================================
+disk_init:
+    pusha
+
+    mov ah, 0x41                                ; Check extensions present
+    mov bx, 0x55aa
+    mov dl, [BOOT_DRIVE]
+    int 0x13
+    jc .chs_geometry
+    cmp bx, 0xaa55                              ; BIOS swaps the signature if extensions exist
+    jne .chs_geometry
+    test cl, 1                                  ; Bit 0: Disk Address Packet access (AH=42h) supported
+    jz .chs_geometry
+
+    mov byte [disk_use_lba], 1
+    popa
+    ret
+
+.chs_geometry:
+    push es
+    xor di, di                                  ; ES:DI = 0:0 works around buggy BIOSes
+    mov es, di
+    mov ah, 0x08                                ; Get drive parameters
+    mov dl, [BOOT_DRIVE]
+    int 0x13
+    pop es
+    jc disk_error
+
+    and cx, 0x3f                                ; CL[5:0] = sectors per track
+    mov [disk_spt], cx
+    movzx dx, dh                                ; DH = last head index
+    inc dx
+    mov [disk_heads], dx
+
+    popa
+    ret
+
+; ==========================================================
+; disk_read
+; Reads CX sectors starting at LBA EAX from drive [BOOT_DRIVE]
+; to ES:0000. Transfers are split into the largest chunks the
+; BIOS allows: at most DISK_MAX_CHUNK sectors, never across a
+; 64 KiB DMA boundary and, for CHS, never across a track.
+; Input: EAX = first LBA, CX = sector count, ES = destination
+;        segment (must be 512-byte aligned)
+; ==========================================================
+disk_read:
+    pushad
+
+    mov [dap_lba], eax
+    mov [dap_segment], es
+    mov [disk_remaining], cx
+
+.next_chunk:
+    mov cx, [disk_remaining]
+    jcxz .done
+
+    mov ax, [dap_segment]                       ; Sectors left before the next 64 KiB boundary:
+    shl ax, 4                                   ; (0x10000 - (linear & 0xffff)) / 512
+    neg ax
+    shr ax, 9
+    jnz .boundary_ok
+    mov ax, 128                                 ; Buffer sits exactly on a boundary
+.boundary_ok:
+    cmp ax, DISK_MAX_CHUNK
+    jbe .max_ok
+    mov ax, DISK_MAX_CHUNK
+.max_ok:
+    cmp cx, ax
+    jbe .chunk_ok
+    mov cx, ax
+.chunk_ok:
+    cmp byte [disk_use_lba], 0
+    je .chs_read
+
+    mov [dap_count], cx
+    mov si, disk_address_packet                 ; DS:SI = Disk Address Packet
+    mov ah, 0x42                                ; Extended read
+    mov dl, [BOOT_DRIVE]
+    int 0x13
+    jc disk_error
+    mov cx, [dap_count]
+    jmp .advance
+
+.chs_read:
+    mov eax, [dap_lba]                          ; track = LBA / spt, sector index = LBA % spt
+    xor edx, edx
+    movzx ebx, word [disk_spt]
+    div ebx
+
+    mov bx, [disk_spt]                          ; Don't read past the end of the track
+    sub bx, dx
+    cmp cx, bx
+    jbe .track_ok
+    mov cx, bx
+.track_ok:
+    push cx
+
+    inc dx                                      ; CHS sectors are 1-based
+    mov di, dx
+    xor edx, edx                                ; cylinder = track / heads, head = track % heads
+    movzx ebx, word [disk_heads]
+    div ebx
+
+    mov ch, al                                  ; CH = cylinder bits 0-7
+    mov cl, ah
+    shl cl, 6                                   ; CL[7:6] = cylinder bits 8-9
+    or cx, di                                   ; CL[5:0] = sector
+    mov dh, dl                                  ; DH = head
+    mov dl, [BOOT_DRIVE]
+
+    pop ax                                      ; AL = sectors to read
+    push ax
+    push es
+    mov es, [dap_segment]
+    xor bx, bx
+    mov ah, 0x02                                ; Read sectors
+    int 0x13
+    pop es
+    pop cx
+    jc disk_error
+
+.advance:
+    sub [disk_remaining], cx
+    movzx ecx, cx
+    add [dap_lba], ecx
+    shl cx, 5                                   ; Sectors -> paragraphs (512 / 16)
+    add [dap_segment], cx
+    jmp .next_chunk
+
+.done:
+    popad
+    ret
+
+; Data
+align 4
+disk_address_packet:
+                        db 0x10                 ; Packet size
+                        db 0                    ; Reserved
+dap_count:              dw 0                    ; Sectors to transfer
+dap_offset:             dw 0                    ; Destination offset
+dap_segment:            dw 0                    ; Destination segment
+dap_lba:                dd 0                    ; Starting LBA (low 32 bits)
+                        dd 0                    ; Starting LBA (high 32 bits)
+
+disk_use_lba            db 0
+disk_spt                dw 0
+disk_heads              dw 0
+disk_remaining          dw 0
@@ -0,0 +1,23 @@
+; ==========================================================
+; enable_a20
+; Opens the A20 gate so memory above 1 MiB is not aliased to
+; low memory. Asks the BIOS first and falls back to the
+; "fast A20" bit of system control port 0x92.
+; ==========================================================
+[bits 16]
+
+enable_a20:
+    pusha
+
+    mov ax, 0x2401                              ; BIOS: enable A20 gate
+    int 0x15
+    jnc .done
+
+    in al, 0x92
+    or al, 0x02
+    and al, 0xfe                                ; Bit 0 would reset the CPU
+    out 0x92, al
+
+.done:
+    popa
+    ret
@@ -4,10 +4,16 @@ load_kernel:
     mov bx, MSG_LOAD_KERNEL
     call print_string
 
-    mov bx, KERNEL_OFFSET                   ; Set up parameters for our disk loading function, we will load first 15
-    mov dh, 15                              ; sectors from boot disk to address KERNEL_OFFSET
-    mov dl, [BOOT_DRIVE]
-    call disk_load
+    call disk_init                          ; Pick extended (LBA) or CHS reads for the boot drive
+
+    mov ax, KERNEL_SEGMENT                  ; Set up parameters for our disk loading function, we will load
+    mov es, ax                              ; KERNEL_SECTORS (sized by the build from kernel.bin) sectors
+    mov eax, KERNEL_LBA                     ; following stage 2 to address KERNEL_OFFSET
+    mov cx, KERNEL_SECTORS
+    call disk_read
+
+    xor ax, ax
+    mov es, ax
 
     ret
 
@@ -0,0 +1,112 @@
+; ==========================================================
+; vbe_set_mode
+; Switches to a VBE 2.0 linear-framebuffer mode of
+; VBE_WIDTH x VBE_HEIGHT x 32 bpp and records it in
+; BOOT_INFO_FB_*, along with the address of the BIOS 8x16
+; font for the kernel's framebuffer console.
+; Stays in text mode, with BOOT_INFO_FB_ADDR left at 0, if the
+; BIOS doesn't offer such a mode.
+; Only assembled when the build passes -D VBE_WIDTH/VBE_HEIGHT.
+; ==========================================================
+[bits 16]
+
+VBE_CONTROLLER_INFO     equ 0x2000              ; 512-byte scratch buffers in free low memory
+VBE_MODE_INFO           equ 0x2200              ; (only used before the kernel runs)
+
+VBE_SUCCESS             equ 0x004f
+VBE_MODE_LFB            equ 0x4000              ; Mode number bit: use the linear framebuffer
+
+; Offsets into the mode info block
+VBE_MI_ATTRIBUTES       equ 0x00
+VBE_MI_PITCH            equ 0x10
+VBE_MI_WIDTH            equ 0x12
+VBE_MI_HEIGHT           equ 0x14
+VBE_MI_BPP              equ 0x19
+VBE_MI_MEMORY_MODEL     equ 0x1b
+VBE_MI_FRAMEBUFFER      equ 0x28
+
+VBE_ATTR_NEEDED         equ 0x0091              ; Supported, graphics, linear framebuffer
+VBE_MODEL_DIRECT        equ 6                   ; Direct colour
+
+vbe_set_mode:
+    pushad
+    push es
+    push fs
+
+    mov ax, 0x1130                              ; Get font information
+    mov bh, 6                                   ; 8x16 ROM font -> ES:BP
+    int 0x10
+    xor eax, eax
+    mov ax, es
+    shl eax, 4
+    movzx ebp, bp
+    add eax, ebp
+    mov [BOOT_INFO_FONT], eax
+
+    xor ax, ax
+    mov es, ax
+
+    mov dword [VBE_CONTROLLER_INFO], 'VBE2'     ; Ask for the VBE 2.0 fields
+    mov ax, 0x4f00                              ; Get controller information
+    mov di, VBE_CONTROLLER_INFO
+    int 0x10
+    cmp ax, VBE_SUCCESS
+    jne .done
+
+    mov si, [VBE_CONTROLLER_INFO + 14]          ; Far pointer to the 0xFFFF-terminated mode list
+    mov fs, [VBE_CONTROLLER_INFO + 16]
+
+.next_mode:
+    mov cx, [fs:si]
+    cmp cx, 0xffff
+    je .done
+    add si, 2
+
+    mov ax, 0x4f01                              ; Get mode information for CX
+    mov di, VBE_MODE_INFO
+    push si
+    push cx
+    int 0x10
+    pop cx
+    pop si
+    cmp ax, VBE_SUCCESS
+    jne .next_mode
+
+    mov ax, [VBE_MODE_INFO + VBE_MI_ATTRIBUTES]
+    and ax, VBE_ATTR_NEEDED
+    cmp ax, VBE_ATTR_NEEDED
+    jne .next_mode
+    cmp word [VBE_MODE_INFO + VBE_MI_WIDTH], VBE_WIDTH
+    jne .next_mode
+    cmp word [VBE_MODE_INFO + VBE_MI_HEIGHT], VBE_HEIGHT
+    jne .next_mode
+    cmp byte [VBE_MODE_INFO + VBE_MI_BPP], 32
+    jne .next_mode
+    cmp byte [VBE_MODE_INFO + VBE_MI_MEMORY_MODEL], VBE_MODEL_DIRECT
+    jne .next_mode
+
+    mov ax, 0x4f02                              ; Set mode CX with the linear framebuffer
+    mov bx, cx
+    or bx, VBE_MODE_LFB
+    push si
+    int 0x10
+    pop si
+    cmp ax, VBE_SUCCESS
+    jne .next_mode
+
+    mov eax, [VBE_MODE_INFO + VBE_MI_FRAMEBUFFER]
+    mov [BOOT_INFO_FB_ADDR], eax
+    movzx eax, word [VBE_MODE_INFO + VBE_MI_PITCH]
+    mov [BOOT_INFO_FB_PITCH], eax
+    movzx eax, word [VBE_MODE_INFO + VBE_MI_WIDTH]
+    mov [BOOT_INFO_FB_WIDTH], eax
+    movzx eax, word [VBE_MODE_INFO + VBE_MI_HEIGHT]
+    mov [BOOT_INFO_FB_HEIGHT], eax
+    movzx eax, byte [VBE_MODE_INFO + VBE_MI_BPP]
+    mov [BOOT_INFO_FB_BPP], eax
+
+.done:
+    pop fs
+    pop es
+    popad
+    ret
@@ -0,0 +1,545 @@
+/**
+ * fbcon.c
+ *
+ * Framebuffer Text Console
+ *
+ * Draws the console into a 32 bpp linear framebuffer (set up by the
+ * boot loader through VBE) using the BIOS 8x16 font. screen.c forwards
+ * its output here once fbcon_init() has succeeded, so screen_putc(),
+ * screen_print() and kprintf() work unchanged.
+ *
+ * --------------------------------------------------------------------
+ * TEXT GRID
+ * --------------------------------------------------------------------
+ *
+ * The console is still a grid of cells in RAM (`cells`), each holding
+ * a character and a VGA attribute byte exactly like text mode. Output
+ * only updates the grid and a dirty rectangle (in cells); pixels are
+ * produced by fbcon_flush(), which runs at the same points as the
+ * text-mode flush (newline, a screen's width of pending characters,
+ * or an explicit screen_flush()).
+ *
+ * Scrolling moves the grid in RAM and counts the lines in
+ * `pending_scroll`; the flush then scrolls the framebuffer with a
+ * single memmove, however many lines were added since the last flush,
+ * and draws only the dirty rectangle (which includes the new lines).
+ *
+ * --------------------------------------------------------------------
+ * GLYPH CACHE
+ * --------------------------------------------------------------------
+ *
+ * A font row is one byte (8 pixels). For a colour pair, every possible
+ * byte value is expanded once into its 8 ready-made 32-bit pixels, so
+ * drawing a glyph is 16 row copies of 8 dwords with no per-pixel bit
+ * tests. Tables for FBCON_GLYPH_CACHE colour pairs are kept; a new pair
+ * replaces the oldest table.
+ *
+ * Colours come from the 16-entry VGA palette and assume the usual
+ * x8r8g8b8 layout of 32 bpp VBE direct-colour modes.
+ *
+ */
+
+#include "fbcon.h"
+#include "screen.h"
+#include "memory.h"
+
+#define NO_CELL 0xFFFFFFFF
+#define CURSOR_HEIGHT 2                 // Scan lines of the underline cursor
+
+typedef struct {
+    uint32_t attr;                      // Colour pair of the table, NO_CELL if unused
+    uint32_t rows[256][FBCON_GLYPH_WIDTH];  // Pixels for every font row byte
+} glyph_table_t;
+
+// Standard VGA text-mode palette, x8r8g8b8
+static const uint32_t palette[16] = {
+    0x000000, 0x0000AA, 0x00AA00, 0x00AAAA, 0xAA0000, 0xAA00AA, 0xAA5500, 0xAAAAAA,
+    0x555555, 0x5555FF, 0x55FF55, 0x55FFFF, 0xFF5555, 0xFF55FF, 0xFFFF55, 0xFFFFFF,
+};
+
+static bool active;
+static uint32_t *framebuffer;
+static uint32_t pitch_pixels;           // Framebuffer stride in 32-bit pixels
+static uint32_t cols;
+static uint32_t rows;
+
+static uint8_t font[FBCON_GLYPHS * FBCON_GLYPH_HEIGHT];  // RAM copy of the BIOS font
+static uint16_t cells[FBCON_MAX_ROWS * FBCON_MAX_COLS];
+
+static uint32_t cursor_cell;
+static uint32_t drawn_cursor = NO_CELL; // Cell the cursor is drawn at in the framebuffer
+static uint32_t pending_scroll;         // Grid lines scrolled since the last flush
+static uint32_t pending_chars;
+static uint32_t dirty_x0, dirty_y0;     // Dirty rectangle in cells, [x0,x1) x [y0,y1)
+static uint32_t dirty_x1, dirty_y1;
+
+static glyph_table_t glyph_cache[FBCON_GLYPH_CACHE];
+static glyph_table_t *glyph_last;       // Most recently used table
+static uint32_t glyph_victim;           // Next table to replace
+
+static fbcon_stats_t stats;
+
+static void fbcon_emit(char c, uint8_t attr);
+static void scroll_grid(uint8_t attr);
+static void mark_dirty(uint32_t row, uint32_t x0, uint32_t x1);
+static void render_cell(uint32_t cell);
+static void update_cursor(void);
+static const glyph_table_t *glyph_table(uint8_t attr);
+
+/**
+ * @brief Take over console output on a linear framebuffer.
+ *
+ * @param mode Framebuffer and font handed over by the boot loader. The
+ *             framebuffer must be accessible at mode->addr.
+ *
+ * @return true if the console now draws to the framebuffer, false if
+ *         the mode is unusable (not 32 bpp, no font, too small).
+ */
+bool fbcon_init(const fbcon_mode_t *mode)
+{
+    if (!mode->addr || mode->bpp != 32 || !mode->font)
+    {
+        return false;
+    }
+
+    cols = mode->width / FBCON_GLYPH_WIDTH;
+    rows = mode->height / FBCON_GLYPH_HEIGHT;
+    if (cols == 0 || rows == 0)
+    {
+        return false;
+    }
+    if (cols > FBCON_MAX_COLS)
+    {
+        cols = FBCON_MAX_COLS;
+    }
+    if (rows > FBCON_MAX_ROWS)
+    {
+        rows = FBCON_MAX_ROWS;
+    }
+
+    framebuffer = (uint32_t *) mode->addr;
+    pitch_pixels = mode->pitch / sizeof(uint32_t);
+    memcpy(font, mode->font, sizeof(font));
+
+    for (uint32_t i = 0; i < FBCON_GLYPH_CACHE; i++)
+    {
+        glyph_cache[i].attr = NO_CELL;
+    }
+
+    active = true;
+    return true;
+}
+
+/**
+ * @brief Check whether console output goes to the framebuffer.
+ */
+bool fbcon_active(void)
+{
+    return active;
+}
+
+/**
+ * @brief Get the width of the text grid in cells.
+ */
+uint32_t fbcon_cols(void)
+{
+    return cols;
+}
+
+/**
+ * @brief Get the height of the text grid in cells.
+ */
+uint32_t fbcon_rows(void)
+{
+    return rows;
+}
+
+/**
+ * @brief Blank the whole grid and redraw it.
+ *
+ * @param attr Attribute of the blank cells.
+ *
+ * @note Like screen_clear(), does not move the cursor.
+ */
+void fbcon_clear(uint8_t attr)
+{
+    memset16(cells, (uint16_t) ((attr << 8) | ' '), rows * cols);
+    dirty_x0 = dirty_y0 = 0;
+    dirty_x1 = cols;
+    dirty_y1 = rows;
+    fbcon_flush();
+}
+
+/**
+ * @brief Output a buffer of characters.
+ *
+ * Same control characters and flush rules as screen_write(): the grid
+ * is updated per character, the framebuffer once at the end if the
+ * buffer contained a newline or a row's worth of characters is pending.
+ *
+ * @param buf  Characters to print (not NUL-terminated).
+ * @param len  Number of characters in @p buf.
+ * @param attr Attribute for the new characters.
+ */
+void fbcon_write(const char *buf, size_t len, uint8_t attr)
+{
+    bool newline = false;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        fbcon_emit(buf[i], attr);
+        newline |= buf[i] == '\n';
+    }
+
+    pending_chars += len;
+    if (newline || pending_chars >= cols)
+    {
+        fbcon_flush();
+    }
+}
+
+/**
+ * @brief Scroll the grid up by one line, keeping the cursor on its text.
+ *
+ * @param attr Attribute of the new blank line.
+ */
+void fbcon_scroll(uint8_t attr)
+{
+    scroll_grid(attr);
+    if (cursor_cell >= cols)
+    {
+        cursor_cell -= cols;
+    }
+}
+
+/**
+ * @brief Bring the framebuffer up to date with the grid.
+ *
+ * Applies the pending scroll with one memmove (skipped if everything
+ * is redrawn anyway), draws the dirty rectangle, then moves the cursor.
+ */
+void fbcon_flush(void)
+{
+    bool redraw_all = dirty_x0 == 0 && dirty_x1 == cols && dirty_y0 == 0 && dirty_y1 == rows;
+
+    if (pending_scroll)
+    {
+        uint32_t line_pixels = FBCON_GLYPH_HEIGHT * pitch_pixels;
+
+        if (!redraw_all)
+        {
+            memmove(framebuffer,
+                    framebuffer + pending_scroll * line_pixels,
+                    (rows - pending_scroll) * line_pixels * sizeof(uint32_t));
+            stats.scrolls++;
+        }
+
+        if (drawn_cursor != NO_CELL && drawn_cursor >= pending_scroll * cols)
+        {
+            drawn_cursor -= pending_scroll * cols;
+        }
+        else
+        {
+            drawn_cursor = NO_CELL;
+        }
+
+        pending_scroll = 0;
+    }
+
+    for (uint32_t row = dirty_y0; row < dirty_y1; row++)
+    {
+        for (uint32_t col = dirty_x0; col < dirty_x1; col++)
+        {
+            render_cell(row * cols + col);
+        }
+    }
+
+    if (drawn_cursor != NO_CELL)
+    {
+        uint32_t row = drawn_cursor / cols;
+        uint32_t col = drawn_cursor % cols;
+        if (row >= dirty_y0 && row < dirty_y1 && col >= dirty_x0 && col < dirty_x1)
+        {
+            drawn_cursor = NO_CELL;     // Painted over by the rectangle
+        }
+    }
+
+    dirty_x0 = dirty_y0 = dirty_x1 = dirty_y1 = 0;
+    update_cursor();
+
+    pending_chars = 0;
+    stats.flushes++;
+}
+
+/**
+ * @brief Move the cursor and redraw it straight away.
+ *
+ * @param cell Cursor position as a cell index (row * cols + col).
+ */
+void fbcon_set_cursor(uint32_t cell)
+{
+    if (cell >= rows * cols)
+    {
+        cell = rows * cols - 1;
+    }
+
+    cursor_cell = cell;
+    update_cursor();
+}
+
+/**
+ * @brief Get the cursor position as a cell index.
+ */
+uint32_t fbcon_get_cursor(void)
+{
+    return cursor_cell;
+}
+
+/**
+ * @brief Get the rendering counters.
+ *
+ * @param out Receives a copy of the counters.
+ */
+void fbcon_get_stats(fbcon_stats_t *out)
+{
+    *out = stats;
+}
+
+/**
+ * @brief Put one character into the grid.
+ *
+ * @param c    Character to output.
+ * @param attr Attribute for the character.
+ */
+static void fbcon_emit(char c, uint8_t attr)
+{
+    uint16_t blank = (uint16_t) ((attr << 8) | ' ');
+
+    if (c == '\n')
+    {
+        cursor_cell = (cursor_cell / cols + 1) * cols;
+    }
+    else if (c == '\r')
+    {
+        cursor_cell -= cursor_cell % cols;
+    }
+    else if (c == '\b')
+    {
+        if (cursor_cell > 0)
+        {
+            cursor_cell--;
+            cells[cursor_cell] = blank;
+            mark_dirty(cursor_cell / cols, cursor_cell % cols, cursor_cell % cols + 1);
+        }
+    }
+    else if (c == '\t')
+    {
+        // Advance to the next tab stop, blanking the skipped cells
+        uint32_t col = cursor_cell % cols;
+        uint32_t next_tab = (col + TAB_WIDTH) & ~(TAB_WIDTH - 1);
+
+        if (next_tab > cols)
+        {
+            next_tab = cols;
+        }
+
+        mark_dirty(cursor_cell / cols, col, next_tab);
+        memset16(&cells[cursor_cell], blank, next_tab - col);
+        cursor_cell += next_tab - col;
+    }
+    else
+    {
+        cells[cursor_cell] = (uint16_t) ((attr << 8) | (uint8_t) c);
+        mark_dirty(cursor_cell / cols, cursor_cell % cols, cursor_cell % cols + 1);
+        cursor_cell++;
+    }
+
+    if (cursor_cell >= rows * cols)
+    {
+        scroll_grid(attr);
+        cursor_cell -= cols;
+    }
+}
+
+/**
+ * @brief Scroll the grid by one line and account for it at the next flush.
+ *
+ * The dirty rectangle moves up with the text and grows to include the
+ * new bottom line.
+ *
+ * @param attr Attribute of the new blank line.
+ */
+static void scroll_grid(uint8_t attr)
+{
+    memmove(cells, cells + cols, (rows - 1) * cols * sizeof(uint16_t));
+    memset16(cells + (rows - 1) * cols, (uint16_t) ((attr << 8) | ' '), cols);
+
+    if (dirty_y1 > 1)
+    {
+        dirty_y0 = dirty_y0 ? dirty_y0 - 1 : 0;
+        dirty_y1--;
+    }
+    else
+    {
+        dirty_x0 = dirty_y0 = dirty_x1 = dirty_y1 = 0;
+    }
+    mark_dirty(rows - 1, 0, cols);
+
+    if (pending_scroll < rows)
+    {
+        pending_scroll++;
+    }
+    if (pending_scroll == rows)
+    {
+        // Nothing on screen survives: the flush redraws everything
+        // instead of scrolling
+        dirty_x0 = dirty_y0 = 0;
+        dirty_x1 = cols;
+        dirty_y1 = rows;
+    }
+}
+
+/**
+ * @brief Grow the dirty rectangle to cover part of a row.
+ *
+ * @param row Grid row.
+ * @param x0  First dirty column.
+ * @param x1  One past the last dirty column.
+ */
+static void mark_dirty(uint32_t row, uint32_t x0, uint32_t x1)
+{
+    if (dirty_x1 == 0)
+    {
+        dirty_x0 = x0;
+        dirty_x1 = x1;
+        dirty_y0 = row;
+        dirty_y1 = row + 1;
+        return;
+    }
+
+    if (x0 < dirty_x0)
+    {
+        dirty_x0 = x0;
+    }
+    if (x1 > dirty_x1)
+    {
+        dirty_x1 = x1;
+    }
+    if (row < dirty_y0)
+    {
+        dirty_y0 = row;
+    }
+    if (row + 1 > dirty_y1)
+    {
+        dirty_y1 = row + 1;
+    }
+}
+
+/**
+ * @brief Draw one cell from the grid into the framebuffer.
+ *
+ * @param cell Cell index (row * cols + col).
+ */
+static void render_cell(uint32_t cell)
+{
+    uint16_t value = cells[cell];
+    const glyph_table_t *table = glyph_table(value >> 8);
+    const uint8_t *glyph = &font[(value & 0xFF) * FBCON_GLYPH_HEIGHT];
+    uint32_t *dst = framebuffer
+                  + (cell / cols) * FBCON_GLYPH_HEIGHT * pitch_pixels
+                  + (cell % cols) * FBCON_GLYPH_WIDTH;
+
+    for (uint32_t y = 0; y < FBCON_GLYPH_HEIGHT; y++, dst += pitch_pixels)
+    {
+        const uint32_t *src = table->rows[glyph[y]];
+
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst[3] = src[3];
+        dst[4] = src[4];
+        dst[5] = src[5];
+        dst[6] = src[6];
+        dst[7] = src[7];
+    }
+
+    stats.glyphs++;
+}
+
+/**
+ * @brief Move the drawn cursor to cursor_cell.
+ *
+ * The old position is redrawn from the grid; the cursor is an
+ * underline in the cell's foreground colour.
+ */
+static void update_cursor(void)
+{
+    if (drawn_cursor == cursor_cell)
+    {
+        return;
+    }
+
+    if (drawn_cursor != NO_CELL)
+    {
+        render_cell(drawn_cursor);
+    }
+
+    uint32_t colour = palette[(cells[cursor_cell] >> 8) & 0x0F];
+    uint32_t *dst = framebuffer
+                  + ((cursor_cell / cols + 1) * FBCON_GLYPH_HEIGHT - CURSOR_HEIGHT) * pitch_pixels
+                  + (cursor_cell % cols) * FBCON_GLYPH_WIDTH;
+
+    for (uint32_t y = 0; y < CURSOR_HEIGHT; y++, dst += pitch_pixels)
+    {
+        for (uint32_t x = 0; x < FBCON_GLYPH_WIDTH; x++)
+        {
+            dst[x] = colour;
+        }
+    }
+
+    drawn_cursor = cursor_cell;
+}
+
+/**
+ * @brief Get the expanded glyph rows for a colour pair.
+ *
+ * Builds the table (replacing the oldest one) on a miss.
+ *
+ * @param attr VGA attribute byte (background << 4 | foreground).
+ *
+ * @return Table whose rows[b] are the 8 pixels of font row byte b.
+ */
+static const glyph_table_t *glyph_table(uint8_t attr)
+{
+    if (glyph_last && glyph_last->attr == attr)
+    {
+        return glyph_last;
+    }
+
+    for (uint32_t i = 0; i < FBCON_GLYPH_CACHE; i++)
+    {
+        if (glyph_cache[i].attr == attr)
+        {
+            glyph_last = &glyph_cache[i];
+            return glyph_last;
+        }
+    }
+
+    glyph_table_t *table = &glyph_cache[glyph_victim];
+    glyph_victim = (glyph_victim + 1) % FBCON_GLYPH_CACHE;
+
+    uint32_t fg = palette[attr & 0x0F];
+    uint32_t bg = palette[attr >> 4];
+    for (uint32_t bits = 0; bits < 256; bits++)
+    {
+        for (uint32_t x = 0; x < FBCON_GLYPH_WIDTH; x++)
+        {
+            table->rows[bits][x] = (bits & (0x80 >> x)) ? fg : bg;
+        }
+    }
+
+    table->attr = attr;
+    glyph_last = table;
+    stats.cache_fills++;
+    return table;
+}
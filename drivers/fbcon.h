@@ -0,0 +1,47 @@
+#ifndef FBCON_H_
+#define FBCON_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define FBCON_GLYPH_WIDTH 8
+#define FBCON_GLYPH_HEIGHT 16
+#define FBCON_GLYPHS 256
+
+// Largest text grid kept in RAM (1280x1024 with 8x16 glyphs)
+#define FBCON_MAX_COLS 160
+#define FBCON_MAX_ROWS 64
+
+// Colour pairs with a pre-expanded glyph table (8 KiB each)
+#define FBCON_GLYPH_CACHE 4
+
+typedef struct {
+    uint32_t addr;                      // Linear framebuffer, mapped 1:1
+    uint32_t pitch;                     // Bytes per scan line
+    uint32_t width;                     // Pixels
+    uint32_t height;
+    uint32_t bpp;                       // Only 32 is supported
+    const uint8_t *font;                // FBCON_GLYPHS glyphs of FBCON_GLYPH_HEIGHT bytes
+} fbcon_mode_t;
+
+typedef struct {
+    uint32_t glyphs;                    // Cells rendered
+    uint32_t scrolls;                   // Framebuffer memmoves (any number of lines)
+    uint32_t flushes;
+    uint32_t cache_fills;               // Glyph tables built for a new colour pair
+} fbcon_stats_t;
+
+bool fbcon_init(const fbcon_mode_t *mode);
+bool fbcon_active(void);
+uint32_t fbcon_cols(void);
+uint32_t fbcon_rows(void);
+void fbcon_clear(uint8_t attr);
+void fbcon_write(const char *buf, size_t len, uint8_t attr);
+void fbcon_scroll(uint8_t attr);
+void fbcon_flush(void);
+void fbcon_set_cursor(uint32_t cell);
+uint32_t fbcon_get_cursor(void);
+void fbcon_get_stats(fbcon_stats_t *stats);
+
+#endif
@@ -1,14 +1,68 @@
+/**
+ * keyboard.c
+ *
+ * PS/2 Keyboard (scan code set 1)
+ *
+ * The IRQ1 handler only reads the scancode from the controller and
+ * appends it to a KBD_RING_SIZE ring: one port read, a store and an
+ * index update, so IRQ1 stays short even while the console is busy.
+ * Decoding happens in kbd_read(), outside interrupt context:
+ *
+ *     - 0xE0 prefixes select the extended keys (arrows, Page Up/Down,
+ *       right Ctrl/Alt, keypad Enter and /); the fake Shift codes some
+ *       keyboards wrap around them are dropped
+ *     - the 0xE1 Pause sequence becomes a single KEY_PAUSE press
+ *     - releases become events with KBD_RELEASED set
+ *     - Shift, Ctrl, Alt and Caps Lock are tracked and applied to the
+ *       character (Ctrl+letter gives the control code)
+ *
+ * The ring has one producer (the IRQ handler) and one consumer (the
+ * caller of kbd_read()), so it needs no lock: each side only writes
+ * its own index. Scancodes arriving while it is full are dropped.
+ *
+ * The keypad reports digits regardless of Num Lock, and the keyboard
+ * LEDs are not updated.
+ *
+ */
+
 #include "keyboard.h"
 
 #include "port.h"
-#include "pic.h"
-#include "screen.h"
-#include "../lib/kprintf.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #define KEYBOARD_DATA_PORT 0x60
 #define KEYBOARD_STATUS_PORT 0x64
+#define KEYBOARD_OUTPUT_FULL 0x01       // Status: a byte is waiting at the data port
+
+#define SCANCODE_EXTENDED 0xE0
+#define SCANCODE_PAUSE 0xE1             // Followed by five more bytes
+#define SCANCODE_RELEASE 0x80
+#define SCANCODE_FAKE_LSHIFT (KEY_EXTENDED | KEY_LSHIFT)
+#define SCANCODE_FAKE_RSHIFT (KEY_EXTENDED | KEY_RSHIFT)
+
+#define RING_MASK (KBD_RING_SIZE - 1)
+
+// Modifier keys held down
+#define HELD_LSHIFT 0x01
+#define HELD_RSHIFT 0x02
+#define HELD_LCTRL  0x04
+#define HELD_RCTRL  0x08
+#define HELD_LALT   0x10
+#define HELD_RALT   0x20
+
+static uint8_t ring[KBD_RING_SIZE];
+static uint32_t ring_head;              // Written by the IRQ handler only
+static uint32_t ring_tail;              // Written by kbd_read() only
+
+static kbd_stats_t stats;
+
+// Decoder state (kbd_read() side)
+static bool extended;                   // Previous byte was the 0xE0 prefix
+static uint32_t pause_bytes;            // Bytes of a Pause sequence still to skip
+static uint32_t held;                   // HELD_*
+static bool caps_lock;
 
 // Scan Code Set 1 to ASCII lookup table (lowercase only)
 // Index = scancode, Value = ASCII character (0 = unmapped)
@@ -32,26 +86,242 @@ static const char scancode_to_ascii[128] =
      0,    0,    0,    0,    0,    0,    0,    0,      // 0x78:
 };
 
+// Scan Code Set 1 to ASCII with Shift held
+static const char scancode_to_ascii_shift[128] =
+{
+     0,    27,   '!',  '@',  '#',  '$',  '%',  '^',   // 0x00: [None] [Esc]  1  2  3  4  5  6
+     '&',  '*',  '(',  ')',  '_',  '+',  '\b', '\t',  // 0x08: 7  8  9  0  -  =  [Backspace]  [Tab]
+     'Q',  'W',  'E',  'R',  'T',  'Y',  'U',  'I',   // 0x10: q  w  e  r  t  y  u  i
+     'O',  'P',  '{',  '}',  '\n', 0,    'A',  'S',   // 0x18: o  p  [  ]  [Enter]  [LCtrl]  a  s
+     'D',  'F',  'G',  'H',  'J',  'K',  'L',  ':',   // 0x20: d  f  g  h  j  k  l  ;
+     '"',  '~',  0,    '|',  'Z',  'X',  'C',  'V',   // 0x28: '  `  [LShift]  \  z  x  c  v
+     'B',  'N',  'M',  '<',  '>',  '?',  0,    '*',   // 0x30: b  n  m  ,  .  /  [RShift]  [KP *]
+     0,    ' ',  0,    0,    0,    0,    0,    0,      // 0x38: [LAlt]  [Space]  [Caps]  [F1]  [F2]  [F3]  [F4]  [F5]
+     0,    0,    0,    0,    0,    0,    0,    '7',    // 0x40: [F6]  [F7]  [F8]  [F9]  [F10]  [Num]  [Scroll]  [KP 7]
+     '8',  '9',  '-',  '4',  '5',  '6',  '+',  '1',  // 0x48: [KP 8]  [KP 9]  [KP -]  [KP 4]  [KP 5]  [KP 6]  [KP +]  [KP 1]
+     '2',  '3',  '0',  '.',  0,    0,    0,    0,     // 0x50: [KP 2]  [KP 3]  [KP 0]  [KP .]  ...  ...  ...  [F11]
+     0,    0,    0,    0,    0,    0,    0,    0,      // 0x58: [F12]  ...
+     0,    0,    0,    0,    0,    0,    0,    0,      // 0x60:
+     0,    0,    0,    0,    0,    0,    0,    0,      // 0x68:
+     0,    0,    0,    0,    0,    0,    0,    0,      // 0x70:
+     0,    0,    0,    0,    0,    0,    0,    0,      // 0x78:
+};
+
 void keyboard_init()
 {
-    // Enable the keyboard IRQ (IRQ1)
-    pic_irq_clear_mask(1);
+    // IRQ1 is unmasked by irq_register(). Drop any byte already waiting:
+    // with an edge-triggered line, a full output buffer would never
+    // raise another interrupt.
+    while (port_byte_in(KEYBOARD_STATUS_PORT) & KEYBOARD_OUTPUT_FULL)
+    {
+        port_byte_in(KEYBOARD_DATA_PORT);
+    }
 }
 
-void keyboard_handler()
+/**
+ * @brief IRQ1 handler (see irq_register()): queue the raw scancode.
+ */
+bool keyboard_handler(void *ctx)
 {
-    uint8_t scancode = port_byte_in(0x60);
+    (void)ctx;
+    uint8_t scancode = port_byte_in(KEYBOARD_DATA_PORT);
+    uint32_t head = ring_head;
 
-    // Skip the 0xE0 extended prefix for now
-    if (scancode == 0xE0)
-        return;
+    stats.scancodes++;
+    if (head - __atomic_load_n(&ring_tail, __ATOMIC_ACQUIRE) == KBD_RING_SIZE)
+    {
+        stats.dropped++;
+        return true;
+    }
+
+    ring[head & RING_MASK] = scancode;
+    __atomic_store_n(&ring_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief Get the KBD_* modifier flags currently in effect.
+ */
+static uint8_t modifier_flags(void)
+{
+    uint8_t flags = 0;
+
+    if (held & (HELD_LSHIFT | HELD_RSHIFT))
+    {
+        flags |= KBD_SHIFT;
+    }
+    if (held & (HELD_LCTRL | HELD_RCTRL))
+    {
+        flags |= KBD_CTRL;
+    }
+    if (held & (HELD_LALT | HELD_RALT))
+    {
+        flags |= KBD_ALT;
+    }
+    if (caps_lock)
+    {
+        flags |= KBD_CAPS_LOCK;
+    }
+    return flags;
+}
 
-    // Skip key releases (bit 7 set)
-    if (scancode & 0x80)
+/**
+ * @brief Track a modifier key going down or up.
+ */
+static void update_modifiers(uint8_t key, bool released)
+{
+    uint32_t bit;
+
+    switch (key)
+    {
+    case KEY_LSHIFT: bit = HELD_LSHIFT; break;
+    case KEY_RSHIFT: bit = HELD_RSHIFT; break;
+    case KEY_LCTRL:  bit = HELD_LCTRL;  break;
+    case KEY_RCTRL:  bit = HELD_RCTRL;  break;
+    case KEY_LALT:   bit = HELD_LALT;   break;
+    case KEY_RALT:   bit = HELD_RALT;   break;
+    case KEY_CAPS_LOCK:
+        if (!released)
+        {
+            caps_lock = !caps_lock;
+        }
         return;
+    default:
+        return;
+    }
+
+    if (released)
+    {
+        held &= ~bit;
+    }
+    else
+    {
+        held |= bit;
+    }
+}
+
+/**
+ * @brief Get the character a key produces under the given modifiers.
+ */
+static char key_to_ascii(uint8_t key, uint8_t flags)
+{
+    if (key & KEY_EXTENDED)
+    {
+        return key == KEY_KP_ENTER ? '\n' : key == KEY_KP_SLASH ? '/' : 0;
+    }
+
+    char c = (flags & KBD_SHIFT) ? scancode_to_ascii_shift[key] : scancode_to_ascii[key];
+    bool letter = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+
+    if (letter && (flags & KBD_CAPS_LOCK))
+    {
+        c ^= 0x20;                      // Caps Lock inverts the case Shift gave
+    }
+    if (letter && (flags & KBD_CTRL))
+    {
+        c &= 0x1F;                      // Ctrl+A = 0x01 ...
+    }
+    return c;
+}
+
+/**
+ * @brief Feed one scancode to the decoder.
+ *
+ * @return true if it completed a key event, stored in @p event.
+ */
+static bool decode(uint8_t scancode, kbd_event_t *event)
+{
+    if (pause_bytes)
+    {
+        pause_bytes--;
+        return false;
+    }
+    if (scancode == SCANCODE_PAUSE)
+    {
+        pause_bytes = 5;
+        event->key = KEY_PAUSE;
+        event->flags = modifier_flags();
+        event->ascii = 0;
+        return true;                    // Pause has no release code
+    }
+    if (scancode == SCANCODE_EXTENDED)
+    {
+        extended = true;
+        return false;
+    }
+
+    bool released = scancode & SCANCODE_RELEASE;
+    uint8_t key = (scancode & ~SCANCODE_RELEASE) | (extended ? KEY_EXTENDED : 0);
+    extended = false;
 
-    // Only handle key presses - look up in scancode table
-    char c = scancode_to_ascii[scancode];
-    if (c)
-        screen_putc(c);
-}
\ No newline at end of file
+    if (key == SCANCODE_FAKE_LSHIFT || key == SCANCODE_FAKE_RSHIFT)
+    {
+        return false;
+    }
+
+    update_modifiers(key, released);
+
+    event->key = key;
+    event->flags = modifier_flags() | (released ? KBD_RELEASED : 0);
+    event->ascii = key_to_ascii(key, event->flags);
+    return true;
+}
+
+/**
+ * @brief Get the next key event.
+ *
+ * Decodes queued scancodes until one completes an event. Must be
+ * called from a single context, never from an interrupt handler.
+ *
+ * @param event Receives the event.
+ * @param wait  Sleep (hlt) until a key arrives instead of returning
+ *              false; interrupts must be enabled.
+ *
+ * @return false if @p wait is false and no event is pending.
+ */
+bool kbd_read(kbd_event_t *event, bool wait)
+{
+    for (;;)
+    {
+        uint32_t tail = ring_tail;
+
+        while (tail != __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE))
+        {
+            uint8_t scancode = ring[tail & RING_MASK];
+            __atomic_store_n(&ring_tail, ++tail, __ATOMIC_RELEASE);
+
+            if (decode(scancode, event))
+            {
+                stats.events++;
+                return true;
+            }
+        }
+
+        if (!wait)
+        {
+            return false;
+        }
+
+        // sti only takes effect after the next instruction, so an IRQ
+        // arriving after the check still wakes the hlt
+        __asm__ volatile ("cli" : : : "memory");
+        if (ring_tail == __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE))
+        {
+            __asm__ volatile ("sti; hlt" : : : "memory");
+        }
+        else
+        {
+            __asm__ volatile ("sti" : : : "memory");
+        }
+    }
+}
+
+/**
+ * @brief Get the keyboard counters.
+ *
+ * @param out Receives a copy of the counters.
+ */
+void kbd_get_stats(kbd_stats_t *out)
+{
+    *out = stats;
+}
@@ -1,7 +1,73 @@
 #ifndef KEYBOARD_H_
 #define KEYBOARD_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+
+#define KEYBOARD_IRQ 1
+
+// Raw scancodes buffered between IRQ1 and the decoder (power of two)
+#define KBD_RING_SIZE 128
+
+/*
+ * Key codes: the scan code set 1 make code, with 0x80 added for keys
+ * that follow an 0xE0 prefix. ASCII keys are also reported in `ascii`.
+ */
+#define KEY_ESC         0x01
+#define KEY_BACKSPACE   0x0E
+#define KEY_TAB         0x0F
+#define KEY_ENTER       0x1C
+#define KEY_LCTRL       0x1D
+#define KEY_LSHIFT      0x2A
+#define KEY_RSHIFT      0x36
+#define KEY_LALT        0x38
+#define KEY_CAPS_LOCK   0x3A
+#define KEY_F1          0x3B
+#define KEY_F10         0x44            // F1-F10 are consecutive
+#define KEY_NUM_LOCK    0x45
+#define KEY_SCROLL_LOCK 0x46
+#define KEY_F11         0x57
+#define KEY_F12         0x58
+#define KEY_PAUSE       0x7F            // Sent as a six-byte 0xE1 sequence
+
+#define KEY_EXTENDED    0x80
+#define KEY_KP_ENTER    (KEY_EXTENDED | 0x1C)
+#define KEY_RCTRL       (KEY_EXTENDED | 0x1D)
+#define KEY_KP_SLASH    (KEY_EXTENDED | 0x35)
+#define KEY_RALT        (KEY_EXTENDED | 0x38)
+#define KEY_HOME        (KEY_EXTENDED | 0x47)
+#define KEY_UP          (KEY_EXTENDED | 0x48)
+#define KEY_PAGE_UP     (KEY_EXTENDED | 0x49)
+#define KEY_LEFT        (KEY_EXTENDED | 0x4B)
+#define KEY_RIGHT       (KEY_EXTENDED | 0x4D)
+#define KEY_END         (KEY_EXTENDED | 0x4F)
+#define KEY_DOWN        (KEY_EXTENDED | 0x50)
+#define KEY_PAGE_DOWN   (KEY_EXTENDED | 0x51)
+#define KEY_INSERT      (KEY_EXTENDED | 0x52)
+#define KEY_DELETE      (KEY_EXTENDED | 0x53)
+
+// kbd_event_t flags
+#define KBD_RELEASED    0x01            // Key-up event
+#define KBD_SHIFT       0x02            // Modifier state when the event happened
+#define KBD_CTRL        0x04
+#define KBD_ALT         0x08
+#define KBD_CAPS_LOCK   0x10
+
+typedef struct {
+    uint8_t key;                        // KEY_* code
+    uint8_t flags;                      // KBD_*
+    char ascii;                         // Character for the key, 0 if none
+} kbd_event_t;
+
+typedef struct {
+    uint32_t scancodes;                 // Bytes taken by the IRQ handler
+    uint32_t dropped;                   // Bytes lost to a full ring
+    uint32_t events;                    // Key events decoded
+} kbd_stats_t;
+
 void keyboard_init();
-void keyboard_handler();
+bool keyboard_handler(void *ctx);
+bool kbd_read(kbd_event_t *event, bool wait);
+void kbd_get_stats(kbd_stats_t *stats);
 
-#endif
\ No newline at end of file
+#endif
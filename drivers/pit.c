@@ -0,0 +1,81 @@
+/**
+ * pit.c
+ *
+ * 8253/8254 Programmable Interval Timer
+ *
+ * The PIT has three 16-bit down-counters clocked at PIT_FREQUENCY:
+ *
+ *     channel 0   wired to IRQ0; run as a one-shot (mode 0, pit_arm())
+ *                 that fires once when its count runs out, which is
+ *                 how the tickless timer core (timer.c) drives it
+ *     channel 2   gated and read through port 0x61 (its output also
+ *                 drives the PC speaker, which is kept disconnected);
+ *                 used as a polled one-shot reference for calibrating
+ *                 the TSC, which needs no interrupt at all
+ *
+ * Channel 1 (DRAM refresh on the original PC) is left alone.
+ *
+ * Reading the PIT takes several slow port accesses, so nothing here is
+ * meant for timestamps: ktime.c reads the TSC instead and only uses the
+ * PIT to learn the TSC's frequency.
+ *
+ */
+
+#include "pit.h"
+#include "port.h"
+
+#define PIT_CHANNEL0_DATA   0x40
+#define PIT_CHANNEL2_DATA   0x42
+#define PIT_COMMAND         0x43
+#define PIT_GATE_PORT       0x61
+
+// Command byte fields
+#define PIT_SELECT_CH0      0x00
+#define PIT_SELECT_CH2      0x80
+#define PIT_ACCESS_LOHI     0x30        // Low byte, then high byte
+#define PIT_MODE_ONESHOT    0x00        // Mode 0: interrupt on terminal count
+
+// Port 0x61 bits
+#define GATE_CH2            0x01
+#define GATE_SPEAKER        0x02
+#define GATE_CH2_OUT        0x20
+
+/**
+ * @brief Make channel 0 raise IRQ0 once, @p count PIT clocks from now.
+ *
+ * Replaces any countdown in progress. The output stays high after it
+ * fires, so no further interrupt follows until the channel is armed
+ * again.
+ *
+ * @param count PIT clocks (PIT_FREQUENCY per second), at least 1.
+ */
+void pit_arm(uint16_t count)
+{
+    port_byte_out(PIT_COMMAND, PIT_SELECT_CH0 | PIT_ACCESS_LOHI | PIT_MODE_ONESHOT);
+    port_byte_out(PIT_CHANNEL0_DATA, count & 0xFF);
+    port_byte_out(PIT_CHANNEL0_DATA, count >> 8);
+}
+
+/**
+ * @brief Start a channel 2 countdown of @p count PIT clocks.
+ *
+ * Its output goes high when the count runs out; poll it with
+ * pit_oneshot_expired().
+ */
+void pit_oneshot_start(uint16_t count)
+{
+    // Gate channel 2 on, keep the speaker disconnected
+    port_byte_out(PIT_GATE_PORT, (port_byte_in(PIT_GATE_PORT) & ~GATE_SPEAKER) | GATE_CH2);
+
+    port_byte_out(PIT_COMMAND, PIT_SELECT_CH2 | PIT_ACCESS_LOHI | PIT_MODE_ONESHOT);
+    port_byte_out(PIT_CHANNEL2_DATA, count & 0xFF);
+    port_byte_out(PIT_CHANNEL2_DATA, count >> 8);
+}
+
+/**
+ * @brief Check whether the channel 2 countdown has finished.
+ */
+bool pit_oneshot_expired(void)
+{
+    return port_byte_in(PIT_GATE_PORT) & GATE_CH2_OUT;
+}
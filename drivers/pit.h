@@ -0,0 +1,15 @@
+#ifndef PIT_H_
+#define PIT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PIT_IRQ 0
+#define PIT_FREQUENCY 1193182           // Input clock of every channel, Hz
+#define PIT_MAX_COUNT 0xFFFF            // Longest one-shot, about 55 ms
+
+void pit_arm(uint16_t count);
+void pit_oneshot_start(uint16_t count);
+bool pit_oneshot_expired(void);
+
+#endif
@@ -38,18 +38,111 @@
  *     Bits 7–4 : Background color
  *     Bits 3–0 : Foreground color
  *
+ * --------------------------------------------------------------------
+ * HISTORY BUFFER
+ * --------------------------------------------------------------------
+ * VGA memory is uncached MMIO: every read stalls. All drawing therefore
+ * goes to `history`, an ordinary RAM ring of SCREEN_HISTORY_ROWS text
+ * lines, and VRAM is only ever written, never read.
+ *
+ * Lines are numbered from 0 since boot ("absolute" lines); line L lives
+ * in ring row L % SCREEN_HISTORY_ROWS. The live screen shows lines
+ * top_line..top_line+MAX_ROWS-1; cursor_cell and the dirty bits are
+ * relative to top_line. Scrolling just advances top_line - nothing is
+ * moved in RAM.
+ *
+ * Each live row that changed is flagged in `dirty_rows`. screen_flush()
+ * copies the dirty rows to VRAM, coalescing adjacent rows into one
+ * memcpy. A flush happens:
+ *     - on an explicit screen_flush() call
+ *     - at the end of a screen_write() that contained a newline, or
+ *       once SCREEN_FLUSH_CHARS characters are pending
+ *     - in screen_clear()
+ *
+ * Partial lines may therefore lag until one of these; callers that
+ * print without a newline and need the output visible (keyboard echo,
+ * prompts, panic) call screen_flush().
+ *
+ * --------------------------------------------------------------------
+ * HARDWARE SCROLLING
+ * --------------------------------------------------------------------
+ * Text-mode VRAM is 32 KiB, room for VRAM_ROWS (204) rows, of which the
+ * CRTC displays 25 starting at its start address (registers 0x0C/0x0D,
+ * in cells). VRAM row R holds absolute line vram_base + R, so scrolling
+ * by n lines only moves the start address down n rows; the rows already
+ * in VRAM stay where they are and only the n new rows are copied.
+ *
+ * When the live screen would run past the end of VRAM, vram_load()
+ * rebases: vram_base becomes top_line and the 25 live rows are copied
+ * to the top of VRAM. That is the only copy scrolling ever makes, once
+ * every VRAM_ROWS - MAX_ROWS lines.
+ *
+ * --------------------------------------------------------------------
+ * SCROLLBACK
+ * --------------------------------------------------------------------
+ * screen_view_scroll() (Page Up / Page Down) moves the displayed window
+ * back into the history. While the window stays inside the lines held
+ * in VRAM, only the start address changes. Going further back reloads
+ * VRAM from the history ring once with the VRAM_ROWS lines ending at
+ * the requested window, so the following pages are free again. New
+ * output snaps the view back to the live screen.
+ *
+ * --------------------------------------------------------------------
+ * FRAMEBUFFER CONSOLE
+ * --------------------------------------------------------------------
+ * If the boot loader switched to a VBE graphics mode and fbcon_init()
+ * succeeded, the public functions below forward to fbcon.c instead and
+ * none of the text-mode state is used. There is no scrollback there.
+ *
  */
 
 #include "screen.h"
+#include "fbcon.h"
 #include "port.h"
 #include "memory.h"
+#include "string.h"
+
+#include <stdbool.h>
 
 static uint8_t screen_attr = WHITE_ON_BLACK;
 static uint32_t cursor_cell;;
 
+// Live rows plus overflow rows that absorb a batch of output so
+// screen_write() can scroll once at the end
+#define SHADOW_ROWS (MAX_ROWS * 2)
+
+#define VRAM_ROWS (VIDEO_MEMORY_SIZE / (MAX_COLS * sizeof(uint16_t)))
+#define DISPLAY_UNSET 0xFFFFFFFF
+
+static uint16_t history[SCREEN_HISTORY_ROWS * MAX_COLS];
+static uint32_t top_line;               // Absolute line at live screen row 0
+static uint32_t open_rows;              // Rows from top_line that have been blanked for use
+static uint32_t dirty_rows;             // Bit n set: live row n differs from VRAM
+static uint32_t pending_chars;          // Characters drawn since the last flush
+
+static uint32_t vram_base;              // Absolute line held in VRAM row 0
+static uint32_t vram_lines;             // Lines from vram_base that VRAM holds
+static bool viewing;                    // Display shows scrollback, not the live screen
+static uint32_t view_top;               // Absolute line at the top of the display while viewing
+static uint32_t display_start = DISPLAY_UNSET;  // CRTC start address last written (cells)
+
+static screen_stats_t stats;
+
 static uint32_t cell_from_row_col(uint32_t row, uint32_t column);
 static uint32_t row_from_cell(uint32_t cell);
 static uint32_t col_from_cell(uint32_t cell);
+static void mark_dirty(uint32_t cell);
+static void screen_emit(char c);
+static void scroll_rows(uint32_t lines);
+static void scroll_to_cursor(void);
+static uint16_t *line_ptr(uint32_t line);
+static uint16_t *cell_ptr(uint32_t cell);
+static void open_rows_to(uint32_t rows);
+static uint32_t oldest_line(void);
+static void flush_rows(uint32_t mask);
+static void vram_copy_lines(uint32_t line, uint32_t count);
+static void vram_load(uint32_t base);
+static void display_set_start(uint32_t line);
 
 
 void screen_init()
@@ -63,18 +156,117 @@ void screen_init()
 /**
  * @brief Clear the entire VGA text-mode screen.
  *
- * Fills the VGA text-mode framebuffer with space characters using the
- * current attribute byte (`screen_attr`). Each cell is written as a 16-bit
- * value: high byte = attribute, low byte = ASCII character.
+ * Fills the live rows with space characters using the current attribute
+ * byte (`screen_attr`) and flushes them to VRAM. Each cell is a 16-bit
+ * value: high byte = attribute, low byte = ASCII character. Lines above
+ * the screen stay in the scrollback history.
  *
  * @note This function does not change the hardware cursor position.
  */
 void screen_clear(void)
 {
-    volatile uint16_t *video_memory = (volatile uint16_t *) VIDEO_ADDRESS;
-    for (uint32_t i = 0; i < MAX_ROWS * MAX_COLS; i++)
+    if (fbcon_active())
+    {
+        fbcon_clear(screen_attr);
+        return;
+    }
+
+    open_rows = 0;
+    open_rows_to(MAX_ROWS);
+    dirty_rows = (1u << MAX_ROWS) - 1;
+    screen_flush();
+}
+
+/**
+ * @brief Copy the dirty live rows to VGA memory and show the screen.
+ *
+ * Runs of adjacent dirty rows are copied with a single memcpy. VRAM is
+ * only written, never read. Rebases VRAM (see HARDWARE SCROLLING) if
+ * the live screen no longer fits in it. While the scrollback view is
+ * active the rows are still copied but the display stays where it is.
+ */
+void screen_flush(void)
+{
+    if (fbcon_active())
+    {
+        fbcon_flush();
+        return;
+    }
+
+    if (top_line < vram_base || top_line + MAX_ROWS > vram_base + VRAM_ROWS)
+    {
+        if (viewing)
+        {
+            return;                     // Live rows get copied by vram_load() on return
+        }
+        vram_load(top_line);
+    }
+
+    flush_rows(dirty_rows);
+
+    if (top_line + MAX_ROWS > vram_base + vram_lines)
+    {
+        vram_lines = top_line + MAX_ROWS - vram_base;
+    }
+
+    if (!viewing)
     {
-        video_memory[i] = screen_attr << 8 | ' ';
+        display_set_start(top_line);
+    }
+
+    pending_chars = 0;
+    stats.flushes++;
+}
+
+/**
+ * @brief Move the displayed window through the scrollback history.
+ *
+ * @param lines Lines to move by: negative scrolls back into history,
+ *              positive towards the live screen. The window is clamped
+ *              to the oldest line still held and to the live screen.
+ */
+void screen_view_scroll(int32_t lines)
+{
+    if (fbcon_active())
+    {
+        return;                         // No scrollback on the framebuffer console
+    }
+
+    uint32_t oldest = oldest_line();
+    int64_t target = (int64_t) (viewing ? view_top : top_line) + lines;
+
+    if (target < (int64_t) oldest)
+    {
+        target = oldest;
+    }
+    if (target >= (int64_t) top_line)
+    {
+        screen_view_live();
+        return;
+    }
+
+    viewing = true;
+    view_top = (uint32_t) target;
+
+    if (view_top < vram_base || view_top + MAX_ROWS > vram_base + vram_lines)
+    {
+        // Outside VRAM: reload the VRAM_ROWS lines that end at the window
+        uint32_t base = view_top + MAX_ROWS > VRAM_ROWS ? view_top + MAX_ROWS - VRAM_ROWS : 0;
+        vram_load(base < oldest ? oldest : base);
+    }
+
+    display_set_start(view_top);
+}
+
+/**
+ * @brief Return the display to the live screen.
+ */
+void screen_view_live(void)
+{
+    if (viewing)
+    {
+        viewing = false;
+        screen_flush();
     }
 }
 
@@ -95,43 +287,60 @@ void screen_set_color(uint8_t fg_color, uint8_t bg_color)
  * @brief Set the VGA hardware cursor position (in cells).
  *
  * Writes the cursor position to the VGA controller via I/O ports. The VGA
- * hardware stores the cursor as a cell index (0..MAX_ROWS*MAX_COLS-1),
- * split across two internal registers (high and low byte).
+ * hardware stores the cursor as a VRAM cell index split across two
+ * internal registers (high and low byte); the live screen's offset in
+ * VRAM is added to @p cell.
  *
- * @param cell Cursor position as a cell index.
+ * @param cell Cursor position as a cell index on the live screen.
  */
 void screen_set_cursor(uint32_t cell)
 {
+    if (fbcon_active())
+    {
+        fbcon_set_cursor(cell);
+        return;
+    }
+
+    cell += (top_line - vram_base) * MAX_COLS;
+
     port_byte_out(REG_SCREEN_CTRL, REG_CURSOR_HIGH);
     port_byte_out(REG_SCREEN_DATA, (uint8_t)(cell >> 8));
     port_byte_out(REG_SCREEN_CTRL, REG_CURSOR_LOW);
     port_byte_out(REG_SCREEN_DATA, (uint8_t)(cell & 0xff));
+    stats.cursor_updates++;
+    stats.port_writes += 4;
 }
 
 /**
  * @brief Get the current VGA hardware cursor position (in cells).
  *
  * Reads the cursor position from the VGA controller via I/O ports. The VGA
- * reports the cursor as a cell index split across two registers (high and
- * low byte).
+ * reports the cursor as a VRAM cell index split across two registers
+ * (high and low byte).
  *
- * @return Current cursor position as a cell index.
+ * @return Current cursor position as a cell index on the live screen.
  */
 uint32_t screen_get_cursor(void)
 {
+    if (fbcon_active())
+    {
+        return fbcon_get_cursor();
+    }
+
     port_byte_out(REG_SCREEN_CTRL, REG_CURSOR_HIGH);
     uint32_t cell = (uint32_t)port_byte_in(REG_SCREEN_DATA) << 8;
 
     port_byte_out(REG_SCREEN_CTRL, REG_CURSOR_LOW);
     cell |= (uint32_t)port_byte_in(REG_SCREEN_DATA);
+    stats.port_writes += 2;
 
-    return cell;
+    return cell - (top_line - vram_base) * MAX_COLS;
 }
 
 /**
  * @brief Print a NUL-terminated string to the screen at the current cursor.
  *
- * Outputs characters one-by-one using `screen_putc()`.
+ * Outputs the whole string with a single `screen_write()`.
  *
  * @param str Pointer to a NUL-terminated string. If NULL, the function
  *            returns without printing anything.
@@ -143,33 +352,81 @@ void screen_print(const char *str)
         return;
     }
 
-    while (*str)
-    {
-        screen_putc(*str++);
-    }
+    screen_write(str, strlen(str));
 }
 
 /**
  * @brief Output a single character to the screen.
  *
- * Writes a character to the VGA text-mode framebuffer at the current cursor
- * position, then advances the cursor. Handles basic control characters:
+ * Equivalent to a one-character `screen_write()`; prefer that (or
+ * `screen_print()`) for more than one character, since every call ends
+ * with a hardware cursor update.
+ *
+ * @param c Character to output.
+ */
+void screen_putc(char c)
+{
+    screen_write(&c, 1);
+}
+
+/**
+ * @brief Output a buffer of characters to the screen.
+ *
+ * Writes each character to the history buffer at the current cursor
+ * position and advances the cursor. Handles basic control characters:
  * - '\\n' (newline): move cursor to start of next row
  * - '\\r' (carriage return): move cursor to start of current row
  * - '\\b' (backspace): move cursor back one cell and erase it (if possible)
+ * - '\\t' (tab): advance to the next TAB_WIDTH column, blanking the gap
  *
- * If the cursor moves beyond the last screen row, the screen is scrolled
- * up by one line and the cursor is placed on the last row.
+ * Output past the last screen row continues into overflow rows below
+ * the live screen; the screen is scrolled once, by however many lines
+ * were added, at the end of the call. VRAM is updated by screen_flush()
+ * if the buffer contained a newline or SCREEN_FLUSH_CHARS characters
+ * are pending, and the hardware cursor is updated once. Any scrollback
+ * view returns to the live screen.
  *
- * @param c Character to output.
- *
- * @note This implementation reads and updates the hardware cursor on each
- *       call (via `screen_get_cursor()` / `screen_set_cursor()`).
+ * @param buf Characters to print (not NUL-terminated).
+ * @param len Number of characters in @p buf.
  */
-void screen_putc(char c)
+void screen_write(const char *buf, size_t len)
 {
-    volatile uint16_t *video_memory = (volatile uint16_t *)VIDEO_ADDRESS;
+    if (fbcon_active())
+    {
+        fbcon_write(buf, len, screen_attr);
+        return;
+    }
+
+    bool newline = false;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        screen_emit(buf[i]);
+        newline |= buf[i] == '\n';
+    }
+
+    scroll_to_cursor();
+    screen_view_live();
 
+    pending_chars += len;
+    if (newline || pending_chars >= SCREEN_FLUSH_CHARS)
+    {
+        screen_flush();
+    }
+
+    screen_set_cursor(cursor_cell);
+}
+
+/**
+ * @brief Draw one character into the history buffer.
+ *
+ * Does not scroll unless the overflow rows are exhausted, flush, or
+ * touch the hardware cursor; screen_write() does those once per call.
+ *
+ * @param c Character to output.
+ */
+static void screen_emit(char c)
+{
     if (c == '\n')
     {
         uint32_t row = row_from_cell(cursor_cell);
@@ -185,7 +442,8 @@ void screen_putc(char c)
         if (cursor_cell > 0)
         {
             cursor_cell--;
-            video_memory[cursor_cell] = ((uint16_t)screen_attr << 8) | (uint8_t)' ';
+            *cell_ptr(cursor_cell) = ((uint16_t)screen_attr << 8) | (uint8_t)' ';
+            mark_dirty(cursor_cell);
         }
     }
     else if (c == '\t')
@@ -200,50 +458,285 @@ void screen_putc(char c)
             next_tab = MAX_COLS;
         }
 
+        mark_dirty(cursor_cell);
         while (col < next_tab)
         {
-            video_memory[cursor_cell] = ((uint16_t)screen_attr << 8) | (uint8_t)' ';
+            *cell_ptr(cursor_cell) = ((uint16_t)screen_attr << 8) | (uint8_t)' ';
             cursor_cell++;
             col++;
         }
     }
     else
     {
-        video_memory[cursor_cell] = ((uint16_t)screen_attr << 8) | (uint8_t)c;
+        *cell_ptr(cursor_cell) = ((uint16_t)screen_attr << 8) | (uint8_t)c;
+        mark_dirty(cursor_cell);
         cursor_cell++;
     }
 
-    if (cursor_cell >= (MAX_ROWS * MAX_COLS))
+    if (cursor_cell >= SHADOW_ROWS * MAX_COLS)
+    {
+        scroll_to_cursor();
+    }
+}
+
+/**
+ * @brief Scroll the screen up by one text row.
+ *
+ * The top row moves into the scrollback history and a blank row appears
+ * at the bottom, filled with space characters using the current
+ * attribute. The cursor stays on the same text, i.e. moves up one row
+ * unless it is already on the top row.
+ */
+void screen_scroll(void)
+{
+    if (fbcon_active())
+    {
+        fbcon_scroll(screen_attr);
+        return;
+    }
+
+    scroll_rows(1);
+    if (cursor_cell >= MAX_COLS)
     {
-        screen_scroll();
         cursor_cell -= MAX_COLS;
     }
+}
 
-    screen_set_cursor(cursor_cell);
+/**
+ * @brief Advance the live screen by a number of lines.
+ *
+ * Only moves top_line; lines that scroll in are blanked if nothing was
+ * written to them yet. Rows that are new on screen are marked dirty,
+ * the others are already in VRAM.
+ *
+ * @param lines Number of rows to scroll by.
+ */
+static void scroll_rows(uint32_t lines)
+{
+    uint32_t all = (1u << MAX_ROWS) - 1;
+
+    // Rows leaving the screen stay visible through scrollback, as do
+    // overflow rows that scroll past without ever being on screen
+    flush_rows(lines >= MAX_ROWS ? all : (1u << lines) - 1);
+    if (lines > MAX_ROWS)
+    {
+        vram_copy_lines(top_line + MAX_ROWS, lines - MAX_ROWS);
+    }
+
+    top_line += lines;
+    open_rows = open_rows > lines ? open_rows - lines : 0;
+    open_rows_to(MAX_ROWS);
+
+    uint32_t fresh = lines >= MAX_ROWS ? all : all & ~(all >> lines);
+    dirty_rows = (lines >= MAX_ROWS ? 0 : dirty_rows >> lines) | fresh;
+
+    stats.scrolls++;
 }
 
+/**
+ * @brief Scroll just far enough to bring the cursor row on screen.
+ */
+static void scroll_to_cursor(void)
+{
+    uint32_t row = row_from_cell(cursor_cell);
+    if (row < MAX_ROWS)
+    {
+        return;
+    }
+
+    uint32_t lines = row - (MAX_ROWS - 1);
+    scroll_rows(lines);
+    cursor_cell -= lines * MAX_COLS;
+}
 
 /**
- * @brief Scroll the screen up by one text row.
+ * @brief Get the console output counters.
+ *
+ * @param out Receives a copy of the counters.
+ */
+void screen_get_stats(screen_stats_t *out)
+{
+    *out = stats;
+}
+
+/**
+ * @brief Get the history ring storage of an absolute line.
  *
- * Moves rows 1..MAX_ROWS-1 up to rows 0..MAX_ROWS-2, then clears the last
- * row by filling it with space characters using the current attribute.
+ * @param line Absolute line number.
  *
- * @note This function does not directly update the hardware cursor; callers
- *       should adjust the cursor as needed.
+ * @return Pointer to the line's first cell.
  */
-void screen_scroll(void)
+static uint16_t *line_ptr(uint32_t line)
+{
+    return history + (line % SCREEN_HISTORY_ROWS) * MAX_COLS;
+}
+
+/**
+ * @brief Get the history storage of a live-screen cell.
+ *
+ * Rows that still hold old history are blanked first.
+ *
+ * @param cell Cell index relative to top_line (may be in an overflow row).
+ *
+ * @return Pointer to the cell.
+ */
+static uint16_t *cell_ptr(uint32_t cell)
+{
+    uint32_t row = row_from_cell(cell);
+
+    open_rows_to(row + 1);
+    return line_ptr(top_line + row) + col_from_cell(cell);
+}
+
+/**
+ * @brief Blank rows so that the first @p rows rows from top_line are usable.
+ *
+ * @param rows Number of rows from top_line that must be open.
+ */
+static void open_rows_to(uint32_t rows)
+{
+    while (open_rows < rows)
+    {
+        memset16(line_ptr(top_line + open_rows),
+                 (uint16_t) ((screen_attr << 8) | ' '),
+                 MAX_COLS);
+        open_rows++;
+    }
+}
+
+/**
+ * @brief Get the oldest line still held in the history ring.
+ */
+static uint32_t oldest_line(void)
+{
+    uint32_t end = top_line + (open_rows > MAX_ROWS ? open_rows : MAX_ROWS);
+    return end > SCREEN_HISTORY_ROWS ? end - SCREEN_HISTORY_ROWS : 0;
+}
+
+/**
+ * @brief Copy some of the dirty live rows to VRAM.
+ *
+ * @param mask Live rows to copy (bit n = row n); clean rows are ignored.
+ */
+static void flush_rows(uint32_t mask)
+{
+    uint32_t rows = mask & dirty_rows;
+    uint32_t row = 0;
+
+    dirty_rows &= ~mask;
+
+    while (rows)
+    {
+        if (!(rows & (1u << row)))
+        {
+            row++;
+            continue;
+        }
+
+        uint32_t first = row;
+        while (row < MAX_ROWS && (rows & (1u << row)))
+        {
+            rows &= ~(1u << row);
+            row++;
+        }
+
+        vram_copy_lines(top_line + first, row - first);
+    }
+}
+
+/**
+ * @brief Copy lines from the history ring to their VRAM rows.
+ *
+ * Lines outside the VRAM window are not cached there and are skipped;
+ * vram_load() picks them up from the history when needed. Runs are
+ * split only where the history ring wraps.
+ *
+ * @param line  First absolute line.
+ * @param count Number of lines.
+ */
+static void vram_copy_lines(uint32_t line, uint32_t count)
 {
     volatile uint16_t *video_memory = (volatile uint16_t *) VIDEO_ADDRESS;
+    uint32_t end = line + count;
 
+    if (line < vram_base)
+    {
+        line = vram_base;
+    }
+    if (end > vram_base + VRAM_ROWS)
+    {
+        end = vram_base + VRAM_ROWS;
+    }
 
-    memmove((void *) video_memory,
-            (void *) (video_memory + MAX_COLS),
-            (MAX_ROWS - 1) * MAX_COLS * sizeof(uint16_t));
+    while (line < end)
+    {
+        uint32_t run = SCREEN_HISTORY_ROWS - line % SCREEN_HISTORY_ROWS;
+        if (run > end - line)
+        {
+            run = end - line;
+        }
 
-    memset16((void *) (video_memory + ((MAX_ROWS - 1) * MAX_COLS)),
-             (uint16_t) ((screen_attr << 8) | ' '),
-             MAX_COLS);
+        memcpy((void *) (video_memory + cell_from_row_col(line - vram_base, 0)),
+               line_ptr(line),
+               run * MAX_COLS * sizeof(uint16_t));
+        stats.rows_flushed += run;
+        line += run;
+    }
+}
+
+/**
+ * @brief Refill VRAM from the history ring.
+ *
+ * Copies lines @p base .. (at most) the live screen's last line into
+ * VRAM starting at row 0. Live rows that were copied are no longer
+ * dirty.
+ *
+ * @param base Absolute line to place in VRAM row 0.
+ */
+static void vram_load(uint32_t base)
+{
+    uint32_t end = top_line + MAX_ROWS;
+
+    if (end > base + VRAM_ROWS)
+    {
+        end = base + VRAM_ROWS;
+    }
+
+    vram_base = base;
+    vram_lines = end - base;
+    vram_copy_lines(base, vram_lines);
+
+    if (top_line + MAX_ROWS <= end)
+    {
+        dirty_rows = 0;                 // The whole live screen was copied
+    }
+
+    display_start = DISPLAY_UNSET;      // VRAM moved under the display
+    stats.vram_loads++;
+}
+
+/**
+ * @brief Point the CRTC start address at an absolute line held in VRAM.
+ *
+ * Skips the port writes if the display already starts there.
+ *
+ * @param line Absolute line to show at the top of the display.
+ */
+static void display_set_start(uint32_t line)
+{
+    uint32_t start = (line - vram_base) * MAX_COLS;
+    if (start == display_start)
+    {
+        return;
+    }
+
+    port_byte_out(REG_SCREEN_CTRL, REG_START_HIGH);
+    port_byte_out(REG_SCREEN_DATA, (uint8_t)(start >> 8));
+    port_byte_out(REG_SCREEN_CTRL, REG_START_LOW);
+    port_byte_out(REG_SCREEN_DATA, (uint8_t)(start & 0xff));
+    stats.port_writes += 4;
+
+    display_start = start;
 }
 
 /**
@@ -284,4 +777,20 @@ static uint32_t row_from_cell(uint32_t cell)
 static uint32_t col_from_cell(uint32_t cell)
 {
     return cell % MAX_COLS;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Flag the row containing a cell as needing a flush.
+ *
+ * @param cell Linear cell index that was modified.
+ */
+static void mark_dirty(uint32_t cell)
+{
+    uint32_t row = row_from_cell(cell);
+
+    // Overflow rows are marked when they scroll onto the screen
+    if (row < MAX_ROWS)
+    {
+        dirty_rows |= 1u << row;
+    }
+}
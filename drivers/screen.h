@@ -1,9 +1,11 @@
 #ifndef SCREEN_H_
 #define SCREEN_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 #define VIDEO_ADDRESS 0xb8000
+#define VIDEO_MEMORY_SIZE 0x8000        // Text-mode VRAM window: 0xB8000-0xBFFFF
 #define MAX_ROWS 25
 #define MAX_COLS 80
 // Attribute byte for colour scheme
@@ -13,17 +15,39 @@
 #define REG_SCREEN_CTRL 0x3D4
 #define REG_SCREEN_DATA 0x3D5
 
+#define REG_START_HIGH 12                // Display start address (cells)
+#define REG_START_LOW 13
 #define REG_CURSOR_HIGH 14
 #define REG_CURSOR_LOW 15
 
 #define TAB_WIDTH 4
 
+// Flush the shadow buffer at least this often without a newline
+#define SCREEN_FLUSH_CHARS MAX_COLS
+
+// Lines of output kept in RAM, including the live screen
+#define SCREEN_HISTORY_ROWS 512
+
+typedef struct {
+    uint32_t cursor_updates;            // screen_set_cursor() calls
+    uint32_t port_writes;               // outb to the CRTC ports
+    uint32_t flushes;
+    uint32_t rows_flushed;              // Rows copied to VRAM
+    uint32_t scrolls;                   // Scroll operations (any number of lines)
+    uint32_t vram_loads;                // VRAM refills (wrap or deep scrollback)
+} screen_stats_t;
+
 void screen_init();
 void screen_clear();
 void screen_set_color(uint8_t fg_color, uint8_t bg_color);
 void screen_set_cursor(uint32_t offset);
 uint32_t screen_get_cursor();
 void screen_scroll(void);
+void screen_flush(void);
+void screen_view_scroll(int32_t lines);
+void screen_view_live(void);
 void screen_putc(char c);
+void screen_write(const char *buf, size_t len);
 void screen_print(const char *str);
+void screen_get_stats(screen_stats_t *stats);
 #endif
\ No newline at end of file
@@ -0,0 +1,498 @@
+/**
+ * serial.c
+ *
+ * 16550 UART Serial Console (COM1)
+ *
+ * Gives kprintf() a second, machine-readable console: everything that
+ * goes to the screen is also sent to COM1, which `qemu -serial stdio`
+ * (make run) prints on the host terminal. Newlines are sent as CR LF.
+ *
+ * --------------------------------------------------------------------
+ * TRANSMIT
+ * --------------------------------------------------------------------
+ *
+ * serial_write() only appends to a SERIAL_TX_BUFFER ring and returns.
+ * The UART is fed in bursts: whenever its transmitter is empty, up to
+ * SERIAL_FIFO_SIZE bytes are written back to back into the FIFO,
+ * without reading the line status register (LSR) between them.
+ *
+ *     interrupts on    a THR-empty interrupt (IRQ4) refills the FIFO;
+ *                      the interrupt is enabled only while the ring
+ *                      holds data, and the first burst after an idle
+ *                      period is written by serial_write() itself
+ *     interrupts off   (early boot, exception handlers) serial_write()
+ *                      waits for the transmitter and sends the whole
+ *                      ring before returning, still in bursts, so
+ *                      nothing is lost if the CPU halts next
+ *
+ * If the ring is full, serial_write() makes room the same polled way.
+ * serial_write_polled() is the classic one-LSR-poll-per-byte loop,
+ * kept for comparison (see serial_bench.c).
+ *
+ * --------------------------------------------------------------------
+ * RECEIVE
+ * --------------------------------------------------------------------
+ *
+ * The receive FIFO raises IRQ4 at 14 bytes or after a short idle
+ * timeout; the handler moves everything waiting into a
+ * SERIAL_RX_BUFFER ring, which serial_read() empties. Bytes arriving
+ * while the ring is full are dropped and counted.
+ *
+ * Both rings are only touched with interrupts disabled or from the
+ * IRQ4 handler, so on one CPU no further locking is needed.
+ *
+ */
+
+#include "serial.h"
+#include "port.h"
+
+// Register offsets from the base port
+#define UART_DATA   0                   // RBR (read) / THR (write); DLL with DLAB set
+#define UART_IER    1                   // Interrupt enable; DLM with DLAB set
+#define UART_IIR    2                   // Interrupt identification (read)
+#define UART_FCR    2                   // FIFO control (write)
+#define UART_LCR    3                   // Line control
+#define UART_MCR    4                   // Modem control
+#define UART_LSR    5                   // Line status
+#define UART_MSR    6                   // Modem status
+
+#define IER_RX_DATA     0x01            // Received data available
+#define IER_THR_EMPTY   0x02            // Transmitter holding register empty
+#define IER_LINE_STATUS 0x04            // Overrun, parity, framing error, break
+
+#define IIR_NONE        0x01            // No interrupt pending
+#define IIR_ID_MASK     0x0E
+#define IIR_MODEM       0x00
+#define IIR_THR_EMPTY   0x02
+#define IIR_RX_DATA     0x04
+#define IIR_LINE_STATUS 0x06
+#define IIR_RX_TIMEOUT  0x0C
+#define IIR_FIFO_MASK   0xC0            // Both set: working 16550A FIFO
+
+#define FCR_ENABLE      0x01
+#define FCR_CLEAR_RX    0x02
+#define FCR_CLEAR_TX    0x04
+#define FCR_TRIGGER_14  0xC0            // Receive interrupt at 14 bytes
+
+#define LCR_8N1         0x03            // 8 data bits, no parity, 1 stop bit
+#define LCR_DLAB        0x80            // Divisor latch access
+
+#define MCR_DTR         0x01
+#define MCR_RTS         0x02
+#define MCR_OUT1        0x04
+#define MCR_OUT2        0x08            // Gates the UART interrupt onto the ISA bus
+#define MCR_LOOPBACK    0x10
+
+#define LSR_DATA_READY  0x01
+#define LSR_THR_EMPTY   0x20            // Transmit FIFO empty
+#define LSR_TX_IDLE     0x40            // FIFO and shift register empty
+
+#define UART_CLOCK      115200          // Divisor 1 gives this rate
+
+#define EFLAGS_IF       0x200
+
+#define TX_MASK (SERIAL_TX_BUFFER - 1)
+#define RX_MASK (SERIAL_RX_BUFFER - 1)
+
+static bool present;
+static bool irq_mode;                   // IRQ4 is routed and unmasked
+static uint8_t ier;                     // Shadow of UART_IER
+static uint32_t fifo_size = 1;          // 1 on a UART without a working FIFO
+
+static char tx_ring[SERIAL_TX_BUFFER];
+static volatile uint32_t tx_head;       // Next byte to queue
+static volatile uint32_t tx_tail;       // Next byte to send
+
+static char rx_ring[SERIAL_RX_BUFFER];
+static volatile uint32_t rx_head;
+static volatile uint32_t rx_tail;
+
+static serial_stats_t stats;
+
+// drivers/ has no kernel headers; same as cpu_irq_save()/cpu_irq_restore()
+static inline uint32_t irq_save(void)
+{
+    uint32_t flags;
+    __asm__ volatile ("pushf; pop %0; cli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint32_t flags)
+{
+    __asm__ volatile ("push %0; popf" : : "r"(flags) : "memory", "cc");
+}
+
+static inline uint8_t uart_in(uint16_t reg)
+{
+    return port_byte_in(SERIAL_COM1 + reg);
+}
+
+static inline void uart_out(uint16_t reg, uint8_t value)
+{
+    port_byte_out(SERIAL_COM1 + reg, value);
+}
+
+static inline uint8_t uart_lsr(void)
+{
+    stats.lsr_reads++;
+    return uart_in(UART_LSR);
+}
+
+/**
+ * @brief Initialise COM1: 115200 8N1, FIFOs on, interrupts off.
+ *
+ * Output works from here on by polling; serial_enable_irq() switches
+ * to interrupt-driven transfers once the IDT and PIC are set up.
+ *
+ * @return false if no UART answers at COM1.
+ */
+bool serial_init(void)
+{
+    uart_out(UART_IER, 0);
+    uart_out(UART_LCR, LCR_DLAB);
+    uart_out(UART_DATA, UART_CLOCK / SERIAL_BAUD);
+    uart_out(UART_IER, 0);
+    uart_out(UART_LCR, LCR_8N1);
+    uart_out(UART_FCR, FCR_ENABLE | FCR_CLEAR_RX | FCR_CLEAR_TX | FCR_TRIGGER_14);
+
+    // A byte sent in loopback mode must come straight back
+    uart_out(UART_MCR, MCR_LOOPBACK | MCR_RTS | MCR_OUT1 | MCR_OUT2);
+    uart_out(UART_DATA, 0xAE);
+    if (uart_in(UART_DATA) != 0xAE)
+    {
+        return false;
+    }
+
+    uart_out(UART_MCR, MCR_DTR | MCR_RTS | MCR_OUT2);
+    if ((uart_in(UART_IIR) & IIR_FIFO_MASK) == IIR_FIFO_MASK)
+    {
+        fifo_size = SERIAL_FIFO_SIZE;
+    }
+
+    present = true;
+    return true;
+}
+
+/**
+ * @brief Switch to interrupt-driven transfers on IRQ4.
+ *
+ * Call once serial_handler() is registered for SERIAL_COM1_IRQ (which
+ * unmasks the line).
+ */
+void serial_enable_irq(void)
+{
+    if (!present)
+    {
+        return;
+    }
+
+    uint32_t flags = irq_save();
+    irq_mode = true;
+    ier = IER_RX_DATA | IER_LINE_STATUS;
+    uart_out(UART_IER, ier);
+    irq_restore(flags);
+}
+
+bool serial_active(void)
+{
+    return present;
+}
+
+/**
+ * @brief Write up to one FIFO's worth of queued bytes.
+ *
+ * The transmitter must be empty. Called with interrupts disabled or
+ * from the interrupt handler.
+ */
+static void tx_fill(void)
+{
+    uint32_t tail = tx_tail;
+    uint32_t count = tx_head - tail;
+
+    if (count > fifo_size)
+    {
+        count = fifo_size;
+    }
+    if (!count)
+    {
+        return;
+    }
+
+    stats.tx_bytes += count;
+    stats.tx_bursts++;
+    while (count--)
+    {
+        uart_out(UART_DATA, tx_ring[tail++ & TX_MASK]);
+    }
+    tx_tail = tail;
+}
+
+/**
+ * @brief Wait for the transmitter, then send one burst.
+ */
+static void tx_poll(void)
+{
+    while (!(uart_lsr() & LSR_THR_EMPTY))
+    {
+    }
+    tx_fill();
+}
+
+/**
+ * @brief Start interrupt-driven transmission if it is idle.
+ *
+ * With the THR-empty interrupt off, nothing else will send the queued
+ * bytes, so the first burst is written here when the FIFO is empty and
+ * the interrupt is enabled for the rest.
+ */
+static void tx_kick(void)
+{
+    if (ier & IER_THR_EMPTY)
+    {
+        return;                         // The handler is already on it
+    }
+
+    if (uart_lsr() & LSR_THR_EMPTY)
+    {
+        tx_fill();
+    }
+    if (tx_head != tx_tail)
+    {
+        ier |= IER_THR_EMPTY;
+        uart_out(UART_IER, ier);
+    }
+}
+
+/**
+ * @brief Queue a byte; the ring must be accessed with interrupts off.
+ */
+static inline void tx_put(char c)
+{
+    while (tx_head - tx_tail == SERIAL_TX_BUFFER)
+    {
+        tx_poll();                      // Full: make room ourselves
+    }
+    tx_ring[tx_head & TX_MASK] = c;
+    tx_head++;
+}
+
+/**
+ * @brief Send bytes to COM1.
+ *
+ * Returns once the bytes are queued if interrupts are enabled, and once
+ * they are all in the UART otherwise. "\n" is sent as "\r\n".
+ *
+ * @param buf Bytes to send.
+ * @param len Number of bytes in @p buf.
+ */
+void serial_write(const char *buf, size_t len)
+{
+    if (!present)
+    {
+        return;
+    }
+
+    uint32_t flags = irq_save();
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (buf[i] == '\n')
+        {
+            tx_put('\r');
+        }
+        tx_put(buf[i]);
+    }
+
+    if (irq_mode && (flags & EFLAGS_IF))
+    {
+        tx_kick();
+    }
+    else
+    {
+        while (tx_head != tx_tail)
+        {
+            tx_poll();
+        }
+    }
+
+    irq_restore(flags);
+}
+
+/**
+ * @brief Send bytes by polling the line status before every byte.
+ *
+ * Bypasses the ring (anything queued is sent first); the reference for
+ * the serial benchmark.
+ */
+void serial_write_polled(const char *buf, size_t len)
+{
+    if (!present)
+    {
+        return;
+    }
+
+    uint32_t flags = irq_save();
+
+    while (tx_head != tx_tail)
+    {
+        tx_poll();
+    }
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (buf[i] == '\n')
+        {
+            while (!(uart_lsr() & LSR_THR_EMPTY))
+            {
+            }
+            uart_out(UART_DATA, '\r');
+            stats.tx_bytes++;
+        }
+        while (!(uart_lsr() & LSR_THR_EMPTY))
+        {
+        }
+        uart_out(UART_DATA, buf[i]);
+        stats.tx_bytes++;
+    }
+
+    irq_restore(flags);
+}
+
+/**
+ * @brief Wait until every queued byte has left the UART.
+ */
+void serial_flush(void)
+{
+    if (!present)
+    {
+        return;
+    }
+
+    uint32_t flags = irq_save();
+    if (irq_mode && (flags & EFLAGS_IF))
+    {
+        irq_restore(flags);
+        while (tx_head != tx_tail)
+        {
+            __asm__ volatile ("pause");
+        }
+    }
+    else
+    {
+        while (tx_head != tx_tail)
+        {
+            tx_poll();
+        }
+        irq_restore(flags);
+    }
+
+    while (!(uart_lsr() & LSR_TX_IDLE))
+    {
+    }
+}
+
+/**
+ * @brief Move every byte the receiver holds into the receive ring.
+ */
+static void rx_drain(void)
+{
+    while (uart_lsr() & LSR_DATA_READY)
+    {
+        char c = uart_in(UART_DATA);
+
+        if (rx_head - rx_tail == SERIAL_RX_BUFFER)
+        {
+            stats.rx_dropped++;
+            continue;
+        }
+        rx_ring[rx_head & RX_MASK] = c;
+        rx_head++;
+        stats.rx_bytes++;
+    }
+}
+
+/**
+ * @brief Read received bytes without waiting.
+ *
+ * @param buf Receives up to @p len bytes.
+ * @param len Size of @p buf.
+ *
+ * @return Number of bytes stored in @p buf (0 if nothing arrived).
+ */
+size_t serial_read(char *buf, size_t len)
+{
+    if (!present)
+    {
+        return 0;
+    }
+
+    uint32_t flags = irq_save();
+    size_t count = 0;
+
+    if (!irq_mode)
+    {
+        rx_drain();
+    }
+    while (count < len && rx_tail != rx_head)
+    {
+        buf[count++] = rx_ring[rx_tail & RX_MASK];
+        rx_tail++;
+    }
+
+    irq_restore(flags);
+    return count;
+}
+
+/**
+ * @brief IRQ4 handler: service every pending UART interrupt.
+ *
+ * @return false if the UART had no interrupt pending (IRQ4 is shared
+ *         with COM3 on most PCs).
+ */
+bool serial_handler(void *ctx)
+{
+    (void)ctx;
+    uint8_t iir;
+    bool handled = false;
+
+    while (!((iir = uart_in(UART_IIR)) & IIR_NONE))
+    {
+        handled = true;
+        switch (iir & IIR_ID_MASK)
+        {
+        case IIR_RX_DATA:
+        case IIR_RX_TIMEOUT:
+            stats.rx_irqs++;
+            rx_drain();
+            break;
+        case IIR_THR_EMPTY:
+            stats.tx_irqs++;
+            tx_fill();
+            if (tx_head == tx_tail)
+            {
+                ier &= ~IER_THR_EMPTY;  // Idle until the next serial_write()
+                uart_out(UART_IER, ier);
+            }
+            break;
+        case IIR_LINE_STATUS:
+            uart_lsr();                 // Reading LSR clears the error
+            break;
+        case IIR_MODEM:
+            uart_in(UART_MSR);
+            break;
+        default:
+            return handled;
+        }
+    }
+    return handled;
+}
+
+/**
+ * @brief Get the serial counters.
+ *
+ * @param out Receives a copy of the counters.
+ */
+void serial_get_stats(serial_stats_t *out)
+{
+    *out = stats;
+}
@@ -0,0 +1,36 @@
+#ifndef SERIAL_H_
+#define SERIAL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SERIAL_COM1 0x3F8
+#define SERIAL_COM1_IRQ 4
+#define SERIAL_BAUD 115200
+
+#define SERIAL_FIFO_SIZE 16             // 16550A transmit FIFO depth
+#define SERIAL_TX_BUFFER 4096           // Transmit ring (power of two)
+#define SERIAL_RX_BUFFER 256            // Receive ring (power of two)
+
+typedef struct {
+    uint32_t tx_bytes;                  // Bytes written to the transmitter
+    uint32_t rx_bytes;                  // Bytes read from the receiver
+    uint32_t tx_bursts;                 // FIFO refills (up to SERIAL_FIFO_SIZE bytes each)
+    uint32_t tx_irqs;                   // THR-empty interrupts
+    uint32_t rx_irqs;                   // Receive and receive-timeout interrupts
+    uint32_t lsr_reads;                 // Line status polls
+    uint32_t rx_dropped;                // Received bytes lost to a full ring
+} serial_stats_t;
+
+bool serial_init(void);
+void serial_enable_irq(void);
+bool serial_active(void);
+void serial_write(const char *buf, size_t len);
+void serial_write_polled(const char *buf, size_t len);
+size_t serial_read(char *buf, size_t len);
+void serial_flush(void);
+bool serial_handler(void *ctx);
+void serial_get_stats(serial_stats_t *stats);
+
+#endif
@@ -0,0 +1,244 @@
+/**
+ * acpi.c
+ *
+ * ACPI Table Discovery (MADT only)
+ *
+ * Finds the RSDP the firmware left in low memory, walks the RSDT and
+ * copies what the interrupt code needs out of the MADT: the local APIC
+ * address, the first I/O APIC and where each ISA IRQ really arrives
+ * (QEMU, like most PCs, routes IRQ0 to GSI 2).
+ *
+ * acpi_init() runs before vmm_init(): the tables sit in reserved RAM
+ * that is not necessarily identity-mapped later, so they are read
+ * while paging is still off and nothing points into them afterwards.
+ *
+ * The RSDP is searched for, as the specification says, in the first
+ * KiB of the EBDA and in the BIOS area 0xE0000-0xFFFFF, on 16-byte
+ * boundaries. 64-bit table addresses (XSDT) are not needed on the
+ * machines this runs on; the RSDT is always present as well.
+ *
+ */
+
+#include "acpi.h"
+#include "memory.h"
+
+#include <stddef.h>
+
+#define EBDA_SEGMENT_PTR 0x40E          // BDA word: EBDA segment
+#define BIOS_AREA_START 0xE0000
+#define BIOS_AREA_END 0x100000
+
+#define MADT_LOCAL_APIC     0
+#define MADT_IO_APIC        1
+#define MADT_OVERRIDE       2
+
+#define MADT_PCAT_COMPAT    0x01
+#define MADT_CPU_ENABLED    0x01
+
+typedef struct {
+    char signature[8];                  // "RSD PTR "
+    uint8_t checksum;                   // First 20 bytes sum to 0
+    char oem_id[6];
+    uint8_t revision;
+    uint32_t rsdt_addr;
+} __attribute__((packed)) acpi_rsdp_t;
+
+typedef struct {
+    char signature[4];
+    uint32_t length;                    // Whole table, header included
+    uint8_t revision;
+    uint8_t checksum;                   // Whole table sums to 0
+    char oem_id[6];
+    char oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} __attribute__((packed)) acpi_header_t;
+
+typedef struct {
+    acpi_header_t header;
+    uint32_t lapic_addr;
+    uint32_t flags;
+} __attribute__((packed)) acpi_madt_header_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t length;
+} __attribute__((packed)) madt_entry_t;
+
+typedef struct {
+    madt_entry_t entry;
+    uint8_t processor_id;
+    uint8_t apic_id;
+    uint32_t flags;
+} __attribute__((packed)) madt_local_apic_t;
+
+typedef struct {
+    madt_entry_t entry;
+    uint8_t id;
+    uint8_t reserved;
+    uint32_t addr;
+    uint32_t gsi_base;
+} __attribute__((packed)) madt_io_apic_t;
+
+typedef struct {
+    madt_entry_t entry;
+    uint8_t bus;                        // 0: ISA
+    uint8_t source;                     // ISA IRQ
+    uint32_t gsi;
+    uint16_t flags;
+} __attribute__((packed)) madt_override_t;
+
+static acpi_madt_t madt;
+static bool madt_found;
+
+static bool acpi_checksum(const void *table, uint32_t length)
+{
+    const uint8_t *bytes = table;
+    uint8_t sum = 0;
+
+    for (uint32_t i = 0; i < length; i++)
+    {
+        sum += bytes[i];
+    }
+    return sum == 0;
+}
+
+/**
+ * @brief Search [start, end) for a valid RSDP.
+ */
+static const acpi_rsdp_t *rsdp_scan(uint32_t start, uint32_t end)
+{
+    for (uint32_t addr = start; addr + sizeof(acpi_rsdp_t) <= end; addr += 16)
+    {
+        const acpi_rsdp_t *rsdp = (const acpi_rsdp_t *)addr;
+        if (memcmp(rsdp->signature, "RSD PTR ", 8) == 0 && acpi_checksum(rsdp, sizeof(*rsdp)))
+        {
+            return rsdp;
+        }
+    }
+    return NULL;
+}
+
+static const acpi_rsdp_t *rsdp_find(void)
+{
+    uint32_t ebda = (uint32_t)*(const uint16_t *)EBDA_SEGMENT_PTR << 4;
+    const acpi_rsdp_t *rsdp = NULL;
+
+    if (ebda)
+    {
+        rsdp = rsdp_scan(ebda, ebda + 1024);
+    }
+    if (!rsdp)
+    {
+        rsdp = rsdp_scan(BIOS_AREA_START, BIOS_AREA_END);
+    }
+    return rsdp;
+}
+
+/**
+ * @brief Copy the interesting MADT entries into `madt`.
+ */
+static void madt_parse(const acpi_madt_header_t *table)
+{
+    const uint8_t *p = (const uint8_t *)(table + 1);
+    const uint8_t *end = (const uint8_t *)table + table->header.length;
+
+    madt.lapic_addr = table->lapic_addr;
+    madt.has_8259 = table->flags & MADT_PCAT_COMPAT;
+
+    // Identity mapping unless an override says otherwise
+    for (uint32_t irq = 0; irq < ACPI_ISA_IRQS; irq++)
+    {
+        madt.isa[irq].gsi = irq;
+        madt.isa[irq].flags = 0;
+    }
+
+    while (p + sizeof(madt_entry_t) <= end)
+    {
+        const madt_entry_t *entry = (const madt_entry_t *)p;
+        if (entry->length < sizeof(madt_entry_t) || p + entry->length > end)
+        {
+            break;
+        }
+
+        switch (entry->type)
+        {
+        case MADT_LOCAL_APIC:
+            if (((const madt_local_apic_t *)entry)->flags & MADT_CPU_ENABLED)
+            {
+                madt.cpus++;
+            }
+            break;
+        case MADT_IO_APIC:
+            if (!madt.ioapic_addr)
+            {
+                const madt_io_apic_t *io = (const madt_io_apic_t *)entry;
+                madt.ioapic_addr = io->addr;
+                madt.ioapic_id = io->id;
+                madt.ioapic_gsi_base = io->gsi_base;
+            }
+            break;
+        case MADT_OVERRIDE:
+        {
+            const madt_override_t *ovr = (const madt_override_t *)entry;
+            if (ovr->bus == 0 && ovr->source < ACPI_ISA_IRQS)
+            {
+                madt.isa[ovr->source].gsi = ovr->gsi;
+                madt.isa[ovr->source].flags = ovr->flags;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        p += entry->length;
+    }
+}
+
+/**
+ * @brief Find and parse the MADT. Must run before vmm_init().
+ *
+ * @return true if a MADT describing at least one I/O APIC was found.
+ */
+bool acpi_init(void)
+{
+    const acpi_rsdp_t *rsdp = rsdp_find();
+    if (!rsdp)
+    {
+        return false;
+    }
+
+    const acpi_header_t *rsdt = (const acpi_header_t *)rsdp->rsdt_addr;
+    if (memcmp(rsdt->signature, "RSDT", 4) != 0 || !acpi_checksum(rsdt, rsdt->length))
+    {
+        return false;
+    }
+
+    const uint32_t *tables = (const uint32_t *)(rsdt + 1);
+    uint32_t count = (rsdt->length - sizeof(*rsdt)) / sizeof(uint32_t);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const acpi_header_t *table = (const acpi_header_t *)tables[i];
+        if (memcmp(table->signature, "APIC", 4) == 0 && acpi_checksum(table, table->length))
+        {
+            madt_parse((const acpi_madt_header_t *)table);
+            madt_found = madt.ioapic_addr != 0;
+            break;
+        }
+    }
+
+    return madt_found;
+}
+
+/**
+ * @brief Get the MADT summary.
+ *
+ * @return NULL if acpi_init() found no usable MADT.
+ */
+const acpi_madt_t *acpi_madt(void)
+{
+    return madt_found ? &madt : NULL;
+}
@@ -0,0 +1,34 @@
+#ifndef ACPI_H_
+#define ACPI_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ACPI_ISA_IRQS 16
+
+// MPS INTI flags of an interrupt source override
+#define ACPI_POLARITY_MASK      0x03
+#define ACPI_POLARITY_LOW       0x03
+#define ACPI_TRIGGER_MASK       0x0C
+#define ACPI_TRIGGER_LEVEL      0x0C
+
+typedef struct {
+    uint32_t gsi;                       // Global system interrupt the ISA IRQ arrives on
+    uint16_t flags;                     // ACPI_POLARITY_* / ACPI_TRIGGER_*; 0 = ISA default
+} acpi_isa_irq_t;
+
+// What the kernel needs from the MADT ("APIC" table)
+typedef struct {
+    uint32_t lapic_addr;                // Local APIC MMIO base
+    uint32_t ioapic_addr;               // First I/O APIC: MMIO base
+    uint32_t ioapic_id;
+    uint32_t ioapic_gsi_base;           // GSI of its redirection entry 0
+    uint32_t cpus;                      // Enabled processor local APICs
+    bool has_8259;                      // PCAT_COMPAT: legacy PICs present
+    acpi_isa_irq_t isa[ACPI_ISA_IRQS];  // ISA IRQ routing after overrides
+} acpi_madt_t;
+
+bool acpi_init(void);
+const acpi_madt_t *acpi_madt(void);
+
+#endif
@@ -0,0 +1,241 @@
+/**
+ * apic.c
+ *
+ * Local APIC and I/O APIC
+ *
+ * Replaces the 8259 PIC pair as the IRQ controller when the ACPI MADT
+ * describes an I/O APIC (QEMU always provides one):
+ *
+ *     - the local APIC is enabled with the spurious-interrupt vector
+ *       APIC_SPURIOUS_VECTOR; its EOI is a single MMIO write, where
+ *       the PIC needs one or two port writes (and, for IRQ7/IRQ15, an
+ *       in-service register read to rule out a spurious interrupt)
+ *     - ISA IRQ n is routed through an I/O APIC redirection entry to
+ *       vector IRQ_BASE + n on this CPU, so the IRQ numbering and the
+ *       handlers registered with irq_register() stay the same. The
+ *       entry used, its polarity and trigger mode follow the MADT
+ *       interrupt source overrides (IRQ0 arrives on GSI 2 in QEMU).
+ *     - entries start masked and are unmasked when a handler is
+ *       registered, like lines on the PIC
+ *
+ * Both register windows are mapped uncached with vmm_map(). The 8259s
+ * are masked with pic_disable() but left programmed, and LINT0 (their
+ * virtual-wire input) is masked; booting with `nolapic` keeps them.
+ * Only the boot CPU and the first I/O APIC are used.
+ *
+ */
+
+#include "apic.h"
+#include "acpi.h"
+#include "cpu.h"
+#include "idt.h"
+#include "isr.h"
+#include "pic.h"
+#include "pmm.h"
+#include "vmm.h"
+
+#include <stddef.h>
+
+#define IA32_APIC_BASE      0x1B        // MSR
+#define APIC_BASE_ENABLE    (1u << 11)  // Global enable
+
+// Local APIC registers (byte offsets; each is 32 bits on a 16-byte stride)
+#define LAPIC_ID            0x020
+#define LAPIC_TPR           0x080       // Task priority
+#define LAPIC_EOI           0x0B0
+#define LAPIC_SVR           0x0F0       // Spurious interrupt vector
+#define LAPIC_LVT_TIMER     0x320
+#define LAPIC_LVT_LINT0     0x350
+#define LAPIC_LVT_ERROR     0x370
+
+#define SVR_ENABLE          0x100       // APIC software enable
+#define LVT_MASKED          (1u << 16)
+
+// I/O APIC: an index register and a data window
+#define IOAPIC_REGSEL       0x00
+#define IOAPIC_WINDOW       0x10
+#define IOAPIC_VERSION      0x01        // Bits 16-23: last redirection entry
+#define IOAPIC_REDIR        0x10        // Entry n: low dword 0x10 + 2n, high 0x11 + 2n
+
+#define REDIR_ACTIVE_LOW    (1u << 13)
+#define REDIR_LEVEL         (1u << 15)
+#define REDIR_MASKED        (1u << 16)
+#define REDIR_DEST_SHIFT    24          // High dword: destination APIC ID
+
+extern void isr_stub_apic_spurious(void);
+
+static volatile uint32_t *lapic;
+static volatile uint32_t *ioapic;
+static uint32_t ioapic_entries;
+static uint32_t bsp_id;                 // Local APIC ID of this CPU
+static const acpi_madt_t *madt;
+static bool active;
+
+static inline uint32_t lapic_read(uint32_t reg)
+{
+    return lapic[reg / 4];
+}
+
+static inline void lapic_write(uint32_t reg, uint32_t value)
+{
+    lapic[reg / 4] = value;
+}
+
+static inline uint32_t ioapic_read(uint32_t reg)
+{
+    ioapic[IOAPIC_REGSEL / 4] = reg;
+    return ioapic[IOAPIC_WINDOW / 4];
+}
+
+static inline void ioapic_write(uint32_t reg, uint32_t value)
+{
+    ioapic[IOAPIC_REGSEL / 4] = reg;
+    ioapic[IOAPIC_WINDOW / 4] = value;
+}
+
+/**
+ * @brief Get the redirection entry an ISA IRQ arrives on.
+ *
+ * @return false if the IRQ's GSI is not on this I/O APIC.
+ */
+static bool redir_entry(uint8_t irq, uint32_t *entry)
+{
+    uint32_t gsi = madt->isa[irq].gsi;
+
+    if (gsi < madt->ioapic_gsi_base || gsi - madt->ioapic_gsi_base >= ioapic_entries)
+    {
+        return false;
+    }
+    *entry = gsi - madt->ioapic_gsi_base;
+    return true;
+}
+
+static void apic_unmask(uint8_t irq)
+{
+    uint32_t entry;
+    if (!redir_entry(irq, &entry))
+    {
+        return;
+    }
+
+    uint16_t flags = madt->isa[irq].flags;
+    uint32_t low = IRQ_BASE + irq;      // Fixed delivery, physical destination
+
+    if ((flags & ACPI_POLARITY_MASK) == ACPI_POLARITY_LOW)
+    {
+        low |= REDIR_ACTIVE_LOW;
+    }
+    if ((flags & ACPI_TRIGGER_MASK) == ACPI_TRIGGER_LEVEL)
+    {
+        low |= REDIR_LEVEL;
+    }
+
+    ioapic_write(IOAPIC_REDIR + entry * 2 + 1, bsp_id << REDIR_DEST_SHIFT);
+    ioapic_write(IOAPIC_REDIR + entry * 2, low);
+}
+
+static void apic_mask(uint8_t irq)
+{
+    uint32_t entry;
+    if (redir_entry(irq, &entry))
+    {
+        ioapic_write(IOAPIC_REDIR + entry * 2, REDIR_MASKED | (IRQ_BASE + irq));
+    }
+}
+
+static void apic_eoi(uint8_t irq)
+{
+    (void)irq;
+    lapic_write(LAPIC_EOI, 0);
+}
+
+static const irq_controller_t apic_controller =
+{
+    .name = "I/O APIC",
+    .unmask = apic_unmask,
+    .mask = apic_mask,
+    .eoi = apic_eoi,
+    .spurious = NULL,                   // Delivered on APIC_SPURIOUS_VECTOR instead
+};
+
+/**
+ * @brief Map a 4 KiB register window uncached.
+ */
+static bool apic_map(uint32_t phys)
+{
+    uint32_t page = phys & ~(PAGE_SIZE - 1);
+    uint32_t mapped;
+
+    return vmm_map(page, page, VMM_WRITE | VMM_NO_CACHE) || vmm_translate(page, &mapped);
+}
+
+/**
+ * @brief Take over IRQ delivery from the 8259 PICs.
+ *
+ * Call after acpi_init(), vmm_init() and idt_init().
+ *
+ * @return false (PICs stay in charge) without a MADT, an APIC-capable
+ *         CPU or a mappable register window.
+ */
+bool apic_init(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+
+    madt = acpi_madt();
+    if (!madt)
+    {
+        return false;
+    }
+
+    cpu_cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (!(edx & CPUID_EDX_APIC) || !(edx & CPUID_EDX_MSR))
+    {
+        return false;
+    }
+
+    if (!apic_map(madt->lapic_addr) || !apic_map(madt->ioapic_addr))
+    {
+        return false;
+    }
+
+    uint32_t flags = cpu_irq_save();
+
+    cpu_wrmsr(IA32_APIC_BASE, cpu_rdmsr(IA32_APIC_BASE) | APIC_BASE_ENABLE);
+    lapic = (volatile uint32_t *)madt->lapic_addr;
+    ioapic = (volatile uint32_t *)madt->ioapic_addr;
+
+    ioapic_entries = ((ioapic_read(IOAPIC_VERSION) >> 16) & 0xFF) + 1;
+    for (uint32_t entry = 0; entry < ioapic_entries; entry++)
+    {
+        ioapic_write(IOAPIC_REDIR + entry * 2, REDIR_MASKED);
+    }
+
+    pic_disable();
+    idt_set_descriptor(APIC_SPURIOUS_VECTOR, isr_stub_apic_spurious, 0x8E);
+
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_LVT_LINT0, LVT_MASKED);
+    lapic_write(LAPIC_LVT_TIMER, LVT_MASKED);
+    lapic_write(LAPIC_LVT_ERROR, LVT_MASKED);
+    lapic_write(LAPIC_SVR, SVR_ENABLE | APIC_SPURIOUS_VECTOR);
+    lapic_write(LAPIC_EOI, 0);          // Nothing may be left in service
+    bsp_id = lapic_read(LAPIC_ID) >> 24;
+
+    active = true;
+    irq_set_controller(&apic_controller);
+    cpu_irq_restore(flags);
+    return true;
+}
+
+bool apic_active(void)
+{
+    return active;
+}
+
+/**
+ * @brief Get the local APIC ID of this CPU (valid once apic_init() succeeded).
+ */
+uint32_t apic_lapic_id(void)
+{
+    return bsp_id;
+}
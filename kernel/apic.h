@@ -0,0 +1,13 @@
+#ifndef APIC_H_
+#define APIC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define APIC_SPURIOUS_VECTOR 0xFF       // Low four bits must be set on P6-era CPUs
+
+bool apic_init(void);
+bool apic_active(void);
+uint32_t apic_lapic_id(void);
+
+#endif
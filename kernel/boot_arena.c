@@ -0,0 +1,80 @@
+/**
+ * boot_arena.c
+ *
+ * Boot Arena
+ *
+ * Initialization code needs scratch memory (parsed boot data, tables
+ * that are built once and then copied or discarded) that never has to
+ * outlive kmain()'s setup phase. Instead of sending each of those
+ * through kmalloc/kfree, they are bump-allocated from boot_arena and
+ * the whole arena is handed back to the PMM in one call once
+ * initialization is over.
+ *
+ * --------------------------------------------------------------------
+ * LIFETIME
+ * --------------------------------------------------------------------
+ *
+ *     pmm_init()
+ *     boot_arena_init()        // 2^BOOT_ARENA_ORDER pages from the PMM
+ *       ... init code allocates from boot_arena ...
+ *     boot_arena_release()     // pages go back to the PMM, arena emptied
+ *
+ * Every pointer into the arena is dangling after boot_arena_release().
+ * Code that may run both during and after boot checks
+ * boot_arena_active() first.
+ *
+ */
+
+#include "boot_arena.h"
+#include "pmm.h"
+#include "kprintf.h"
+
+#include <stddef.h>
+
+arena_t boot_arena;
+static uint32_t boot_arena_base;
+
+/**
+ * @brief Allocate the boot arena from the physical allocator.
+ *
+ * Must run after pmm_init(). If the allocation fails the arena is left
+ * empty and every arena_alloc() on it returns NULL.
+ */
+void boot_arena_init(void)
+{
+    uint32_t size = PAGE_SIZE << BOOT_ARENA_ORDER;
+
+    boot_arena_base = pmm_alloc_pages(BOOT_ARENA_ORDER);
+    arena_init(&boot_arena, (void *)boot_arena_base, boot_arena_base ? size : 0);
+}
+
+/**
+ * @brief Return the boot arena to the physical allocator.
+ *
+ * Prints how much of the arena boot actually used, so
+ * BOOT_ARENA_ORDER can be tuned.
+ */
+void boot_arena_release(void)
+{
+    if (!boot_arena_base)
+    {
+        return;
+    }
+
+    kprintf("Boot arena: %u of %u bytes used, released.\n",
+            (uint32_t)boot_arena.peak, (uint32_t)boot_arena.size);
+
+    pmm_free_pages(boot_arena_base, BOOT_ARENA_ORDER);
+    boot_arena_base = 0;
+    arena_init(&boot_arena, NULL, 0);
+}
+
+/**
+ * @brief Check whether the boot arena is still live.
+ *
+ * @return true between boot_arena_init() and boot_arena_release().
+ */
+bool boot_arena_active(void)
+{
+    return boot_arena_base != 0;
+}
@@ -0,0 +1,15 @@
+#ifndef BOOT_ARENA_H_
+#define BOOT_ARENA_H_
+
+#include <stdbool.h>
+#include "arena.h"
+
+#define BOOT_ARENA_ORDER 4              // 2^4 pages = 64 KiB
+
+extern arena_t boot_arena;
+
+void boot_arena_init(void);
+void boot_arena_release(void);
+bool boot_arena_active(void);
+
+#endif
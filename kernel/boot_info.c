@@ -0,0 +1,228 @@
+/**
+ * boot_info.c
+ *
+ * Boot Handoff
+ *
+ * The kernel can be started two ways:
+ *
+ *   1. By boot/boot.asm, which fills boot_info_t at BOOT_INFO_ADDRESS
+ *      and enters _start with EAX = BOOT_INFO_MAGIC.
+ *   2. By a Multiboot loader (e.g. `qemu-system-i386 -kernel`), which
+ *      enters _start with EAX = MULTIBOOT_BOOTLOADER_MAGIC and EBX
+ *      pointing at a multiboot_info_t.
+ *
+ * boot_info_init() normalises the second case into the same
+ * boot_info_t, so the rest of the kernel only ever reads BOOT_INFO.
+ *
+ * The command line and memory map are copied out of the Multiboot
+ * structures, which live in memory the kernel will later reuse.
+ *
+ * --------------------------------------------------------------------
+ * BOOT PARAMETERS
+ * --------------------------------------------------------------------
+ *
+ * boot_params_parse() splits the command line into space-separated
+ * `name` or `name=value` words, held in the boot arena. boot_param()
+ * looks them up; like everything in the boot arena, they are only
+ * available until boot_arena_release().
+ *
+ */
+
+#include "boot_info.h"
+#include "multiboot.h"
+#include "memory.h"
+#include "string.h"
+#include "boot_arena.h"
+
+#include <stddef.h>
+
+typedef struct {
+    const char *name;
+    const char *value;                  // "" for a bare flag
+} boot_param_t;
+
+static boot_param_t *boot_params;
+static uint32_t boot_param_count;
+
+/**
+ * @brief Translate a Multiboot information structure into BOOT_INFO.
+ *
+ * @param mbi Multiboot information passed by the loader in EBX.
+ */
+static void boot_info_from_multiboot(const multiboot_info_t *mbi)
+{
+    boot_info_t *info = BOOT_INFO;
+
+    memset(info, 0, sizeof(*info));
+    info->magic = BOOT_INFO_MAGIC;
+    info->source = BOOT_SOURCE_MULTIBOOT;
+
+    if (mbi->flags & MULTIBOOT_INFO_CMDLINE)
+    {
+        const char *cmdline = (const char *)mbi->cmdline;
+        size_t i = 0;
+        while (cmdline[i] && i < BOOT_CMDLINE_MAX - 1)
+        {
+            info->cmdline[i] = cmdline[i];
+            i++;
+        }
+        info->cmdline[i] = '\0';
+    }
+
+    if (mbi->flags & MULTIBOOT_INFO_MEM_MAP)
+    {
+        uint32_t addr = mbi->mmap_addr;
+        uint32_t end = mbi->mmap_addr + mbi->mmap_length;
+
+        while (addr < end && info->mmap_count < BOOT_MMAP_MAX)
+        {
+            const multiboot_mmap_entry_t *entry = (const multiboot_mmap_entry_t *)addr;
+            boot_mmap_entry_t *out = &info->mmap[info->mmap_count++];
+
+            out->base = entry->addr;
+            out->length = entry->len;
+            out->type = entry->type;
+            out->acpi = 1;              // "Entry valid" per ACPI 3.0
+
+            addr += entry->size + sizeof(entry->size);
+        }
+    }
+    else if (mbi->flags & MULTIBOOT_INFO_MEMORY)
+    {
+        // No full map: synthesise one from the lower/upper memory sizes
+        info->mmap[0].base = 0;
+        info->mmap[0].length = (uint64_t)mbi->mem_lower * 1024;
+        info->mmap[0].type = BOOT_MMAP_AVAILABLE;
+        info->mmap[1].base = 0x100000;
+        info->mmap[1].length = (uint64_t)mbi->mem_upper * 1024;
+        info->mmap[1].type = BOOT_MMAP_AVAILABLE;
+        info->mmap_count = 2;
+    }
+}
+
+/**
+ * @brief Validate and normalise the boot handoff.
+ *
+ * Must run before anything else reads BOOT_INFO. After it returns,
+ * BOOT_INFO->magic is BOOT_INFO_MAGIC and BOOT_INFO->source records
+ * how the kernel was started.
+ *
+ * @param magic     Value of EAX at _start.
+ * @param info_addr Value of EBX at _start.
+ */
+void boot_info_init(uint32_t magic, uint32_t info_addr)
+{
+    if (magic == MULTIBOOT_BOOTLOADER_MAGIC)
+    {
+        boot_info_from_multiboot((const multiboot_info_t *)info_addr);
+    }
+    else if (magic != BOOT_INFO_MAGIC || BOOT_INFO->magic != BOOT_INFO_MAGIC)
+    {
+        // Unknown loader: keep going with an empty handoff
+        memset(BOOT_INFO, 0, sizeof(boot_info_t));
+        BOOT_INFO->magic = BOOT_INFO_MAGIC;
+        BOOT_INFO->source = BOOT_SOURCE_UNKNOWN;
+    }
+}
+
+/**
+ * @brief Split BOOT_INFO->cmdline into boot parameters.
+ *
+ * Must run after boot_arena_init(). If the arena is too small the
+ * partial result is discarded and no parameters are available.
+ */
+void boot_params_parse(void)
+{
+    const char *cmdline = BOOT_INFO->cmdline;
+    arena_mark_t mark = arena_mark(&boot_arena);
+    uint32_t words = 0;
+
+    boot_params = NULL;
+    boot_param_count = 0;
+
+    for (size_t i = 0; cmdline[i]; i++)
+    {
+        if (cmdline[i] != ' ' && (i == 0 || cmdline[i - 1] == ' '))
+        {
+            words++;
+        }
+    }
+    if (words == 0)
+    {
+        return;
+    }
+
+    boot_param_t *params = arena_alloc(&boot_arena, words * sizeof(boot_param_t));
+    if (!params)
+    {
+        return;
+    }
+
+    const char *p = cmdline;
+    while (*p)
+    {
+        if (*p == ' ')
+        {
+            p++;
+            continue;
+        }
+
+        size_t len = 0;
+        while (p[len] && p[len] != ' ')
+        {
+            len++;
+        }
+
+        char *word = arena_alloc_aligned(&boot_arena, len + 1, 1);
+        if (!word)
+        {
+            arena_release(&boot_arena, mark);
+            boot_param_count = 0;
+            return;
+        }
+        memcpy(word, p, len);
+        word[len] = '\0';
+
+        boot_param_t *param = &params[boot_param_count++];
+        param->name = word;
+        param->value = word + len;      // Points at the NUL: bare flag
+        for (size_t i = 0; i < len; i++)
+        {
+            if (word[i] == '=')
+            {
+                word[i] = '\0';
+                param->value = word + i + 1;
+                break;
+            }
+        }
+
+        p += len;
+    }
+
+    boot_params = params;
+}
+
+/**
+ * @brief Look up a boot parameter by name.
+ *
+ * @param name Parameter name, without `=`.
+ *
+ * @return The value ("" for a bare flag), or NULL if the parameter was
+ *         not given or the boot arena has been released.
+ */
+const char *boot_param(const char *name)
+{
+    if (!boot_params || !boot_arena_active())
+    {
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < boot_param_count; i++)
+    {
+        if (strcmp(boot_params[i].name, name) == 0)
+        {
+            return boot_params[i].value;
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,70 @@
+#ifndef BOOT_INFO_H_
+#define BOOT_INFO_H_
+
+#include <stdint.h>
+
+// Fixed handoff area written by the boot loader (see boot/boot_info.asm)
+#define BOOT_INFO_ADDRESS 0x0500
+#define BOOT_INFO_MAGIC   0x534F424C    // "LBOS"
+
+#define BOOT_STAGE_MAX 16               // Room reserved for timestamps; keeps the layout fixed
+#define BOOT_CMDLINE_MAX 128
+#define BOOT_MMAP_MAX 32
+
+typedef enum {
+    BOOT_STAGE_ENTRY = 0,               // Boot sector entry            (boot loader)
+    BOOT_STAGE_DISK_LOADED,             // Kernel read from disk        (boot loader)
+    BOOT_STAGE_PROTECTED_MODE,          // Protected mode entered       (boot loader)
+    BOOT_STAGE_DECOMPRESSED,            // Kernel expanded (COMPRESS=1) (decompression stub)
+    BOOT_STAGE_KMAIN,                   // kmain() entry
+    BOOT_STAGE_MEMORY,                  // pmm_init() done
+    BOOT_STAGE_PAGING,                  // vmm_init() done, paging on
+    BOOT_STAGE_PIC,                     // pic_remap() done
+    BOOT_STAGE_IDT,                     // idt_init() done
+    BOOT_STAGE_KEYBOARD,                // keyboard_init() done
+    BOOT_STAGE_COUNT
+} boot_stage_t;
+
+typedef enum {
+    BOOT_SOURCE_BOOT_SECTOR = 0,        // Our own boot/boot.asm loader
+    BOOT_SOURCE_MULTIBOOT,              // A Multiboot loader (e.g. qemu -kernel)
+    BOOT_SOURCE_UNKNOWN,                // Unrecognised entry; handoff is empty
+} boot_source_t;
+
+// Memory region types, as reported by BIOS E820
+#define BOOT_MMAP_AVAILABLE         1
+#define BOOT_MMAP_RESERVED          2
+#define BOOT_MMAP_ACPI_RECLAIMABLE  3
+#define BOOT_MMAP_ACPI_NVS          4
+#define BOOT_MMAP_BAD               5
+
+typedef struct {
+    uint64_t base;
+    uint64_t length;
+    uint32_t type;                      // BOOT_MMAP_*
+    uint32_t acpi;                      // ACPI 3.0 extended attributes
+} __attribute__((packed)) boot_mmap_entry_t;
+
+typedef struct {
+    uint32_t magic;                     // BOOT_INFO_MAGIC once the area is valid
+    uint32_t source;                    // boot_source_t
+    uint64_t tsc[BOOT_STAGE_MAX];       // RDTSC value per boot_stage_t, 0 if not reached
+    char cmdline[BOOT_CMDLINE_MAX];     // Kernel command line, empty if none
+    uint32_t mmap_count;
+    uint32_t reserved;
+    boot_mmap_entry_t mmap[BOOT_MMAP_MAX];
+    uint32_t fb_addr;                   // VBE linear framebuffer (physical), 0 in text mode
+    uint32_t fb_pitch;                  // Bytes per scan line
+    uint32_t fb_width;                  // Pixels
+    uint32_t fb_height;
+    uint32_t fb_bpp;                    // Bits per pixel
+    uint32_t font_addr;                 // BIOS 8x16 font, 256 glyphs x 16 bytes; 0 if unknown
+} __attribute__((packed)) boot_info_t;
+
+#define BOOT_INFO ((boot_info_t *)BOOT_INFO_ADDRESS)
+
+void boot_info_init(uint32_t magic, uint32_t info_addr);
+void boot_params_parse(void);
+const char *boot_param(const char *name);
+
+#endif
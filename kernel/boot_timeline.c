@@ -0,0 +1,94 @@
+/**
+ * boot_timeline.c
+ *
+ * Boot Stage Timing
+ *
+ * Every boot stage records an RDTSC timestamp in the boot_info_t
+ * handoff area at BOOT_INFO_ADDRESS. The boot loader fills in the
+ * real-mode and protected-mode switch stages; the kernel adds its own
+ * stages with boot_timeline_mark(). boot_timeline_report() prints the
+ * time spent in each stage so startup regressions show up on every
+ * boot.
+ *
+ * Cycles are converted with the TSC frequency measured by ktime_init().
+ *
+ */
+
+#include "boot_timeline.h"
+#include "cpu.h"
+#include "kprintf.h"
+#include "ktime.h"
+#include "math.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+static const char *stage_names[BOOT_STAGE_COUNT] =
+{
+    "Boot sector entry",
+    "Kernel loaded from disk",
+    "Protected mode entered",
+    "Kernel decompressed",
+    "kmain entry",
+    "Physical memory manager ready",
+    "Paging enabled",
+    "PIC remapped",
+    "IDT loaded",
+    "Keyboard initialized",
+};
+
+/**
+ * @brief Record the current TSC value for a kernel boot stage.
+ *
+ * @param stage Stage that has just been reached.
+ */
+void boot_timeline_mark(boot_stage_t stage)
+{
+    if (stage < BOOT_STAGE_COUNT)
+    {
+        BOOT_INFO->tsc[stage] = cpu_rdtsc();
+    }
+}
+
+/**
+ * @brief Print the boot timeline.
+ *
+ * For every stage that was reached, prints the cycles and microseconds
+ * elapsed since the previous recorded stage, followed by the total
+ * from the first recorded stage to the last. Stages that were never
+ * reached (e.g. loader stages under Multiboot) are skipped.
+ */
+void boot_timeline_report(void)
+{
+    uint32_t khz = ktime_tsc_khz();
+    uint64_t prev = 0;
+    uint64_t start = 0;
+
+    kprintf("Boot timeline (TSC %u MHz):\n", khz / 1000);
+
+    for (boot_stage_t stage = BOOT_STAGE_ENTRY; stage < BOOT_STAGE_COUNT; stage++)
+    {
+        uint64_t tsc = BOOT_INFO->tsc[stage];
+        if (tsc == 0)
+        {
+            continue;
+        }
+
+        if (prev == 0)
+        {
+            start = tsc;
+            prev = tsc;
+        }
+
+        uint64_t delta = tsc - prev;
+        kprintf("  %s: +%u cycles, +%u us\n", stage_names[stage],
+                (uint32_t)delta,
+                (uint32_t)udivmod64(delta * 1000, khz, NULL));
+        prev = tsc;
+    }
+
+    if (prev != 0)
+    {
+        kprintf("  Total: %u us\n", (uint32_t)udivmod64((prev - start) * 1000, khz, NULL));
+    }
+}
@@ -0,0 +1,9 @@
+#ifndef BOOT_TIMELINE_H_
+#define BOOT_TIMELINE_H_
+
+#include "boot_info.h"
+
+void boot_timeline_mark(boot_stage_t stage);
+void boot_timeline_report(void);
+
+#endif
@@ -0,0 +1,131 @@
+/**
+ * console_bench.c
+ *
+ * Console Output Benchmark
+ *
+ * Booting with the `consbench` parameter prints BENCH_LINES lines of
+ * BENCH_LINE_CHARS characters three ways and reports, per line, the
+ * TSC cycles spent and the CRTC port writes issued, plus the resulting
+ * throughput in characters per second:
+ *
+ *     putc   - one screen_putc() per character (the old kprintf path)
+ *     write  - one screen_write() per line
+ *     kprintf- one kprintf("%s\n") per line
+ *
+ * Every run scrolls the screen, so the figures include scrolling and
+ * flushing to VRAM. On the framebuffer console (make VBE=1, e.g. under
+ * QEMU's standard VGA) they include glyph rendering instead, and the
+ * glyphs drawn per line are reported in place of port writes.
+ *
+ */
+
+#include "console_bench.h"
+#include "ktime.h"
+#include "cpu.h"
+#include "fbcon.h"
+#include "kprintf.h"
+#include "screen.h"
+#include "math.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BENCH_LINES         32
+#define BENCH_LINE_CHARS    60
+#define BENCH_LINE_BYTES    (BENCH_LINE_CHARS + 1)  // Including the newline
+
+typedef enum {
+    BENCH_PUTC = 0,
+    BENCH_WRITE,
+    BENCH_KPRINTF,
+    BENCH_COUNT
+} bench_path_t;
+
+static const char *bench_names[BENCH_COUNT] = { "putc", "write", "kprintf" };
+
+/**
+ * @brief Print one benchmark line through the given path.
+ */
+static void bench_line(bench_path_t path, const char *line)
+{
+    switch (path)
+    {
+    case BENCH_PUTC:
+        for (size_t i = 0; line[i]; i++)
+        {
+            screen_putc(line[i]);
+        }
+        break;
+    case BENCH_WRITE:
+        screen_write(line, BENCH_LINE_BYTES);
+        break;
+    case BENCH_KPRINTF:
+        kprintf("%s", line);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Get the device work counter for the active console.
+ *
+ * @return CRTC port writes in text mode, glyphs drawn on the framebuffer.
+ */
+static uint32_t bench_work(void)
+{
+    if (fbcon_active())
+    {
+        fbcon_stats_t stats;
+        fbcon_get_stats(&stats);
+        return stats.glyphs;
+    }
+
+    screen_stats_t stats;
+    screen_get_stats(&stats);
+    return stats.port_writes;
+}
+
+/**
+ * @brief Measure cycles, device work and throughput per printed line.
+ */
+void console_benchmark(void)
+{
+    char line[BENCH_LINE_BYTES + 1];
+    uint32_t cycles[BENCH_COUNT];
+    uint32_t work[BENCH_COUNT];
+    uint32_t khz = ktime_tsc_khz();
+
+    for (size_t i = 0; i < BENCH_LINE_CHARS; i++)
+    {
+        line[i] = 'a' + i % 26;
+    }
+    line[BENCH_LINE_CHARS] = '\n';
+    line[BENCH_LINE_CHARS + 1] = '\0';
+
+    for (bench_path_t path = BENCH_PUTC; path < BENCH_COUNT; path++)
+    {
+        uint32_t before = bench_work();
+        uint64_t start = cpu_rdtsc();
+        for (int i = 0; i < BENCH_LINES; i++)
+        {
+            bench_line(path, line);
+        }
+        uint64_t elapsed = cpu_rdtsc() - start;
+
+        cycles[path] = (uint32_t)udivmod64(elapsed, BENCH_LINES, NULL);
+        work[path] = (bench_work() - before) / BENCH_LINES;
+    }
+
+    kprintf("consbench: %u-char lines on the %s console, per line:\n", BENCH_LINE_CHARS,
+            fbcon_active() ? "framebuffer" : "text");
+    for (bench_path_t path = BENCH_PUTC; path < BENCH_COUNT; path++)
+    {
+        uint32_t chars_per_sec = cycles[path]
+            ? (uint32_t)udivmod64((uint64_t)BENCH_LINE_BYTES * khz * 1000, cycles[path], NULL)
+            : 0;
+
+        kprintf("  %s: %u cycles, %u %s, %u chars/sec\n", bench_names[path], cycles[path], work[path],
+                fbcon_active() ? "glyphs" : "port writes", chars_per_sec);
+    }
+}
@@ -0,0 +1,6 @@
+#ifndef CONSOLE_BENCH_H_
+#define CONSOLE_BENCH_H_
+
+void console_benchmark(void);
+
+#endif
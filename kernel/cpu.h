@@ -0,0 +1,142 @@
+#ifndef CPU_H_
+#define CPU_H_
+
+#include <stdint.h>
+
+// EFLAGS bits
+#define EFLAGS_IF (1u << 9)             // Interrupts enabled
+
+// CR0 bits
+#define CR0_MP  (1u << 1)               // Monitor coprocessor: WAIT/FWAIT honour TS
+#define CR0_EM  (1u << 2)               // Emulate x87: FPU/SSE instructions raise #UD/#NM
+#define CR0_TS  (1u << 3)               // Task switched: next FPU/SSE instruction raises #NM
+#define CR0_NE  (1u << 5)               // Native x87 error reporting (#MF)
+#define CR0_WP  (1u << 16)              // Write-protect read-only pages in ring 0
+#define CR0_PG  (1u << 31)              // Paging
+
+// CR4 bits
+#define CR4_PSE (1u << 4)               // 4 MiB pages
+#define CR4_PGE (1u << 7)               // Global pages
+#define CR4_OSFXSR (1u << 9)            // OS supports FXSAVE/FXRSTOR; enables SSE
+#define CR4_OSXMMEXCPT (1u << 10)       // OS handles #XM (SIMD floating-point exceptions)
+
+// CPUID leaf 1, EDX
+#define CPUID_EDX_FPU (1u << 0)
+#define CPUID_EDX_PSE (1u << 3)
+#define CPUID_EDX_MSR (1u << 5)
+#define CPUID_EDX_APIC (1u << 9)
+#define CPUID_EDX_PGE (1u << 13)
+#define CPUID_EDX_FXSR (1u << 24)
+#define CPUID_EDX_SSE (1u << 25)
+#define CPUID_EDX_SSE2 (1u << 26)
+
+// CPUID leaf 7 (subleaf 0), EBX
+#define CPUID_7_EBX_ERMS (1u << 9)      // Enhanced REP MOVSB/STOSB
+
+/**
+ * @brief Read the CPU time stamp counter.
+ *
+ * @return Cycles since reset as a 64-bit value (EDX:EAX).
+ */
+static inline uint64_t cpu_rdtsc(void)
+{
+    uint32_t low, high;
+    __asm__ volatile ("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+/**
+ * @brief Read a model-specific register.
+ */
+static inline uint64_t cpu_rdmsr(uint32_t msr)
+{
+    uint32_t low, high;
+    __asm__ volatile ("rdmsr" : "=a"(low), "=d"(high) : "c"(msr));
+    return ((uint64_t)high << 32) | low;
+}
+
+/**
+ * @brief Write a model-specific register.
+ */
+static inline void cpu_wrmsr(uint32_t msr, uint64_t value)
+{
+    __asm__ volatile ("wrmsr" : : "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)) : "memory");
+}
+
+/**
+ * @brief Execute CPUID for a leaf (subleaf 0).
+ */
+static inline void cpu_cpuid(uint32_t leaf, uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx)
+{
+    __asm__ volatile ("cpuid"
+                      : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                      : "a"(leaf), "c"(0));
+}
+
+static inline uint32_t cpu_read_cr0(void)
+{
+    uint32_t value;
+    __asm__ volatile ("mov %%cr0, %0" : "=r"(value));
+    return value;
+}
+
+static inline void cpu_write_cr0(uint32_t value)
+{
+    __asm__ volatile ("mov %0, %%cr0" : : "r"(value) : "memory");
+}
+
+static inline void cpu_write_cr3(uint32_t value)
+{
+    __asm__ volatile ("mov %0, %%cr3" : : "r"(value) : "memory");
+}
+
+static inline uint32_t cpu_read_cr4(void)
+{
+    uint32_t value;
+    __asm__ volatile ("mov %%cr4, %0" : "=r"(value));
+    return value;
+}
+
+static inline void cpu_write_cr4(uint32_t value)
+{
+    __asm__ volatile ("mov %0, %%cr4" : : "r"(value) : "memory");
+}
+
+/**
+ * @brief Disable interrupts, returning the previous EFLAGS.
+ *
+ * Pair with cpu_irq_restore() so nested critical sections don't
+ * re-enable interrupts early.
+ */
+static inline uint32_t cpu_irq_save(void)
+{
+    uint32_t flags;
+    __asm__ volatile ("pushf; pop %0; cli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+/**
+ * @brief Restore the interrupt flag saved by cpu_irq_save().
+ */
+static inline void cpu_irq_restore(uint32_t flags)
+{
+    __asm__ volatile ("push %0; popf" : : "r"(flags) : "memory", "cc");
+}
+
+/**
+ * @brief Clear CR0.TS without a full CR0 read-modify-write.
+ */
+static inline void cpu_clts(void)
+{
+    __asm__ volatile ("clts" : : : "memory");
+}
+
+/**
+ * @brief Drop the TLB entry for a single page.
+ */
+static inline void cpu_invlpg(uint32_t addr)
+{
+    __asm__ volatile ("invlpg (%0)" : : "r"(addr) : "memory");
+}
+
+#endif
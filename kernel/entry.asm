@@ -1,8 +1,68 @@
 [bits 32]
 extern kmain
+extern __bss_start
+extern __bss_end
 global _start
 
+MULTIBOOT_HEADER_MAGIC      equ 0x1BADB002
+MULTIBOOT_BOOTLOADER_MAGIC  equ 0x2BADB002
+MULTIBOOT_PAGE_ALIGN        equ 1 << 0          ; Align boot modules on 4 KiB boundaries
+MULTIBOOT_MEMORY_INFO       equ 1 << 1          ; Ask for mem_* fields and the memory map
+MULTIBOOT_HEADER_FLAGS      equ MULTIBOOT_PAGE_ALIGN | MULTIBOOT_MEMORY_INFO
+
+KERNEL_STACK_TOP            equ 0x90000         ; Same stack the boot sector sets up
+
+; _start must stay the first byte of kernel.bin: the boot sector calls
+; KERNEL_OFFSET directly. The linker script places .text.entry first.
+section .text.entry progbits alloc exec nowrite align=16
+
 _start:
+    jmp kernel_entry
+
+; Multiboot header - must be 4-byte aligned within the first 8 KiB of the image
+align 4
+multiboot_header:
+    dd MULTIBOOT_HEADER_MAGIC
+    dd MULTIBOOT_HEADER_FLAGS
+    dd -(MULTIBOOT_HEADER_MAGIC + MULTIBOOT_HEADER_FLAGS)
+
+; EAX = loader magic, EBX = loader information
+;   boot sector: BOOT_INFO_MAGIC, BOOT_INFO
+;   Multiboot:   MULTIBOOT_BOOTLOADER_MAGIC, multiboot_info_t *
+kernel_entry:
+    ; Always switch to the kernel's own copy of the flat GDT: a Multiboot
+    ; loader leaves GDTR and ESP undefined, and the boot sector's GDT sits
+    ; in stage 2 memory that the physical allocator hands out later.
+    lgdt [gdt_descriptor]
+    jmp CODE_SEG:.reload_segments
+.reload_segments:
+    mov cx, DATA_SEG
+    mov ds, cx
+    mov es, cx
+    mov fs, cx
+    mov gs, cx
+    mov ss, cx
+
+    cmp eax, MULTIBOOT_BOOTLOADER_MAGIC
+    jne .segments_ready
+    mov esp, KERNEL_STACK_TOP
+
+.segments_ready:
+    push ebx                                    ; kmain(magic, info)
+    push eax
+
+    ; The boot loader only copies the file contents of kernel.bin, so
+    ; .bss holds whatever was in memory before. Zero it first.
+    mov edi, __bss_start
+    mov ecx, __bss_end
+    sub ecx, edi
+    xor eax, eax
+    cld
+    rep stosb
+
     call kmain
 
-    jmp $
\ No newline at end of file
+    jmp $
+
+section .data
+%include "boot/gdt.asm"
@@ -0,0 +1,178 @@
+/**
+ * format_bench.c
+ *
+ * Formatting Benchmark
+ *
+ * Booting with the `fmtbench` parameter formats a few typical kernel
+ * messages 2^BENCH_SHIFT times each into a buffer and prints the
+ * average TSC cycles per call for:
+ *
+ *     old  - the previous kprintf() loop (itoa()/utoa(): a division per
+ *            digit and a reversal copy), kept here as the reference
+ *     new  - ksnprintf()
+ *
+ * Only formatting is measured; nothing is written to the console while
+ * timing. The old loop has no widths or 64-bit values, so the cases
+ * stick to what both understand, except the last two, which only
+ * ksnprintf() can do.
+ *
+ */
+
+#include "format_bench.h"
+#include "cpu.h"
+#include "kprintf.h"
+#include "string.h"
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BENCH_SHIFT 10
+#define BENCH_BUFFER 128
+
+typedef enum {
+    CASE_DECIMAL = 0,                   // One large %u
+    CASE_SIGNED,                        // One negative %d
+    CASE_HEX,                           // One %x
+    CASE_LINE,                          // A typical status line
+    CASE_PADDED,                        // %08x (new only)
+    CASE_WIDE,                          // %llu (new only)
+    CASE_COUNT
+} bench_case_t;
+
+#define CASE_COMMON CASE_PADDED         // Cases below this run on both
+
+static const char *case_names[CASE_COUNT] = {
+    "%u", "%d", "%x", "line", "%08x", "%llu",
+};
+
+/**
+ * @brief The kprintf() formatting loop before kvsnprintf(), into a buffer.
+ *
+ * @return Number of characters written (excluding the NUL).
+ */
+static size_t old_format(char *buf, size_t size, const char *fmt, ...)
+{
+    size_t len = 0;
+    va_list args;
+
+    va_start(args, fmt);
+    while (*fmt && len + 34 < size)
+    {
+        char tmp[34];
+        const char *str = tmp;
+
+        if (*fmt != '%')
+        {
+            buf[len++] = *fmt++;
+            continue;
+        }
+
+        fmt++;
+        if (*fmt == 'd' || *fmt == 'i')
+        {
+            itoa(va_arg(args, int), tmp, 10);
+        }
+        else if (*fmt == 's')
+        {
+            str = va_arg(args, const char *);
+        }
+        else if (*fmt == 'u')
+        {
+            utoa(va_arg(args, uint32_t), tmp, 10);
+        }
+        else if (*fmt == 'x')
+        {
+            itoa(va_arg(args, int), tmp, 16);
+        }
+        else
+        {
+            tmp[0] = '\0';
+        }
+
+        while (*str && len + 1 < size)
+        {
+            buf[len++] = *str++;
+        }
+        fmt++;
+    }
+    va_end(args);
+
+    buf[len] = '\0';
+    return len;
+}
+
+/**
+ * @brief Format one benchmark case with either implementation.
+ */
+static void bench_case(bench_case_t which, bool use_old, char *buf)
+{
+    switch (which)
+    {
+    case CASE_DECIMAL:
+        if (use_old) old_format(buf, BENCH_BUFFER, "%u", 4000000000u);
+        else         ksnprintf(buf, BENCH_BUFFER, "%u", 4000000000u);
+        break;
+    case CASE_SIGNED:
+        if (use_old) old_format(buf, BENCH_BUFFER, "%d", -1234567);
+        else         ksnprintf(buf, BENCH_BUFFER, "%d", -1234567);
+        break;
+    case CASE_HEX:
+        if (use_old) old_format(buf, BENCH_BUFFER, "%x", 0xDEADBEEFu);
+        else         ksnprintf(buf, BENCH_BUFFER, "%x", 0xDEADBEEFu);
+        break;
+    case CASE_LINE:
+        if (use_old) old_format(buf, BENCH_BUFFER, "  %s: %u cycles (%u us)\n", "Paging enabled", 1234567u, 4321u);
+        else         ksnprintf(buf, BENCH_BUFFER, "  %s: %u cycles (%u us)\n", "Paging enabled", 1234567u, 4321u);
+        break;
+    case CASE_PADDED:
+        ksnprintf(buf, BENCH_BUFFER, "%08x", 0xBEEFu);
+        break;
+    case CASE_WIDE:
+        ksnprintf(buf, BENCH_BUFFER, "%llu", 18446744073709551615ull);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Average cycles per call of one case.
+ */
+static uint32_t bench_cycles(bench_case_t which, bool use_old)
+{
+    char buf[BENCH_BUFFER];
+
+    bench_case(which, use_old, buf);    // Warm up
+
+    uint64_t start = cpu_rdtsc();
+    for (int i = 0; i < (1 << BENCH_SHIFT); i++)
+    {
+        bench_case(which, use_old, buf);
+    }
+    return (uint32_t)((cpu_rdtsc() - start) >> BENCH_SHIFT);
+}
+
+/**
+ * @brief Compare the old and new formatting paths, in cycles per call.
+ */
+void format_benchmark(void)
+{
+    kprintf("fmtbench: cycles/call, old (itoa/utoa) vs ksnprintf\n");
+
+    for (bench_case_t which = CASE_DECIMAL; which < CASE_COUNT; which++)
+    {
+        uint32_t new_cycles = bench_cycles(which, false);
+
+        if (which < CASE_COMMON)
+        {
+            uint32_t old_cycles = bench_cycles(which, true);
+            kprintf("  %-5s old %6u  new %6u\n", case_names[which], old_cycles, new_cycles);
+        }
+        else
+        {
+            kprintf("  %-5s old      -  new %6u\n", case_names[which], new_cycles);
+        }
+    }
+}
@@ -0,0 +1,6 @@
+#ifndef FORMAT_BENCH_H_
+#define FORMAT_BENCH_H_
+
+void format_benchmark(void);
+
+#endif
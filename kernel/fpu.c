@@ -0,0 +1,274 @@
+/**
+ * fpu.c
+ *
+ * x87/SSE Enablement and Lazy Context Switching
+ *
+ * fpu_init() detects the FPU, FXSR, SSE and SSE2 through CPUID and, if
+ * FXSAVE/FXRSTOR are available, turns SSE on (CR4.OSFXSR and
+ * CR4.OSXMMEXCPT, CR0.MP set, CR0.EM clear).
+ *
+ * --------------------------------------------------------------------
+ * LAZY SWITCHING
+ * --------------------------------------------------------------------
+ *
+ * The FPU/SSE registers belong to one fpu_context_t at a time, the
+ * `owner`. The context that is currently running is `current`.
+ * Switching `current` costs nothing but setting CR0.TS when the two
+ * differ, or clearing it when they match again; no registers are
+ * saved.
+ *
+ * The first FPU/SSE instruction the new context executes raises #NM.
+ * fpu_handle_nm() then clears TS, FXSAVEs the old owner, FXRSTORs the
+ * new context (or the clean initial state if it never used the FPU)
+ * and makes it the owner. Contexts that never touch SIMD never pay for
+ * a save or restore.
+ *
+ * --------------------------------------------------------------------
+ * CONTEXTS
+ * --------------------------------------------------------------------
+ *
+ * There are no tasks yet, so three contexts exist:
+ *
+ *   - the kernel context: kmain() and everything it calls
+ *   - the interrupt context: hardware IRQ handlers, entered through
+ *     fpu_irq_enter() / fpu_irq_exit()
+ *   - the softirq context: bottom halves (softirq.c), which run with
+ *     interrupts enabled and can themselves be interrupted, entered
+ *     through fpu_softirq_enter() / fpu_softirq_exit()
+ *
+ * An IRQ handler that scrolls the screen with the SSE2 memmove thus
+ * takes an #NM, and the interrupted kernel code gets its registers back
+ * the next time it uses SSE. fpu_switch() is the hook a scheduler will
+ * call for task contexts.
+ *
+ * TS stays clear until the first IRQ, so SSE code may run before the
+ * IDT (and with it the #NM handler) is installed.
+ *
+ */
+
+#include "fpu.h"
+#include "cpu.h"
+
+#include <stddef.h>
+
+#define MXCSR_DEFAULT 0x1F80            // All SIMD exceptions masked, round to nearest
+
+static fpu_context_t kernel_context;
+static fpu_context_t irq_context;
+static fpu_context_t softirq_context;
+static fpu_context_t initial_state;     // Clean image for first-time users
+
+static fpu_context_t *owner;            // Context whose state is in the registers
+static fpu_context_t *current;          // Context that is running
+static fpu_context_t *irq_interrupted;  // `current` before fpu_irq_enter()
+static fpu_context_t *softirq_interrupted;  // `current` before fpu_softirq_enter()
+static bool ts_set;                     // Mirrors CR0.TS to avoid reading CR0
+static bool sse_enabled;
+static fpu_stats_t stats;
+
+static inline void fpu_fxsave(fpu_context_t *context)
+{
+    __asm__ volatile ("fxsave %0" : "=m"(context->state));
+}
+
+static inline void fpu_fxrstor(const fpu_context_t *context)
+{
+    __asm__ volatile ("fxrstor %0" : : "m"(context->state));
+}
+
+/**
+ * @brief Set CR0.TS if @p context doesn't own the registers, clear it
+ *        if it does.
+ *
+ * Clearing matters on the way out of an IRQ that never used the FPU:
+ * the interrupted context still owns the registers, and leaving TS set
+ * would cost it a pointless #NM on its next SSE instruction.
+ */
+static void fpu_update_trap(const fpu_context_t *context)
+{
+    if (context != owner && !ts_set)
+    {
+        cpu_write_cr0(cpu_read_cr0() | CR0_TS);
+        ts_set = true;
+    }
+    else if (context == owner && ts_set)
+    {
+        cpu_clts();
+        ts_set = false;
+    }
+}
+
+/**
+ * @brief Detect and enable the FPU and SSE.
+ *
+ * Leaves the kernel context as the owner with TS clear. Must run before
+ * anything that checks fpu_sse_enabled() (memops_init()).
+ */
+void fpu_init(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+    cpu_cpuid(1, &eax, &ebx, &ecx, &edx);
+
+    if (!(edx & CPUID_EDX_FPU) || !(edx & CPUID_EDX_FXSR))
+    {
+        return;                         // No FXSAVE: leave SSE off, never set TS
+    }
+
+    uint32_t cr0 = cpu_read_cr0();
+    cr0 &= ~(CR0_EM | CR0_TS);
+    cr0 |= CR0_MP | CR0_NE;
+    cpu_write_cr0(cr0);
+
+    if (edx & CPUID_EDX_SSE)
+    {
+        cpu_write_cr4(cpu_read_cr4() | CR4_OSFXSR | CR4_OSXMMEXCPT);
+        sse_enabled = true;
+    }
+
+    __asm__ volatile ("fninit");
+    if (sse_enabled)
+    {
+        uint32_t mxcsr = MXCSR_DEFAULT;
+        __asm__ volatile ("ldmxcsr %0" : : "m"(mxcsr));
+    }
+    fpu_fxsave(&initial_state);
+    initial_state.used = true;
+
+    owner = &kernel_context;
+    current = &kernel_context;
+    kernel_context.used = true;         // Its state is live, not "never used"
+    ts_set = false;
+}
+
+/**
+ * @brief Check whether SSE instructions may be executed.
+ */
+bool fpu_sse_enabled(void)
+{
+    return sse_enabled;
+}
+
+/**
+ * @brief Make @p context the running FPU context.
+ *
+ * Only updates the #NM trap; registers move when @p context first
+ * uses them. Must be called with interrupts disabled.
+ *
+ * @param context Context to run; its `used` flag must be false for a
+ *                context that has never run.
+ */
+void fpu_switch(fpu_context_t *context)
+{
+    if (!owner)
+    {
+        return;                         // FPU not initialized
+    }
+
+    current = context;
+    fpu_update_trap(context);
+}
+
+/**
+ * @brief Switch to the interrupt context on hardware IRQ entry.
+ */
+void fpu_irq_enter(void)
+{
+    if (!owner)
+    {
+        return;
+    }
+
+    irq_interrupted = current;
+    current = &irq_context;
+    fpu_update_trap(current);
+}
+
+/**
+ * @brief Switch back to the interrupted context on IRQ exit.
+ */
+void fpu_irq_exit(void)
+{
+    if (!owner)
+    {
+        return;
+    }
+
+    current = irq_interrupted;
+    fpu_update_trap(current);
+}
+
+/**
+ * @brief Switch to the softirq context before running bottom halves.
+ *
+ * Softirqs don't nest, so one saved context is enough; an IRQ taken
+ * meanwhile returns to the softirq context through fpu_irq_exit().
+ */
+void fpu_softirq_enter(void)
+{
+    if (!owner)
+    {
+        return;
+    }
+
+    softirq_interrupted = current;
+    current = &softirq_context;
+    fpu_update_trap(current);
+}
+
+/**
+ * @brief Switch back to the context the softirqs interrupted.
+ */
+void fpu_softirq_exit(void)
+{
+    if (!owner)
+    {
+        return;
+    }
+
+    current = softirq_interrupted;
+    fpu_update_trap(current);
+}
+
+/**
+ * @brief Handle a Device Not Available (#NM) exception.
+ *
+ * @return true if the trap was a lazy switch and has been serviced,
+ *         false if #NM was unexpected (FPU not initialized).
+ */
+bool fpu_handle_nm(void)
+{
+    if (!owner)
+    {
+        return false;
+    }
+
+    cpu_clts();
+    ts_set = false;
+    stats.nm_traps++;
+
+    if (owner == current)
+    {
+        return true;                    // TS was stale; registers are already right
+    }
+
+    fpu_fxsave(owner);
+    owner->used = true;
+    stats.saves++;
+
+    fpu_fxrstor(current->used ? current : &initial_state);
+    stats.restores++;
+
+    current->used = true;
+    owner = current;
+    return true;
+}
+
+/**
+ * @brief Get the lazy-switching counters.
+ *
+ * @param out Receives a copy of the counters.
+ */
+void fpu_get_stats(fpu_stats_t *out)
+{
+    *out = stats;
+}
@@ -0,0 +1,30 @@
+#ifndef FPU_H_
+#define FPU_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define FPU_STATE_SIZE 512              // FXSAVE area
+
+typedef struct {
+    uint8_t state[FPU_STATE_SIZE] __attribute__((aligned(16)));
+    bool used;                          // state[] holds a saved register image
+} fpu_context_t;
+
+typedef struct {
+    uint32_t nm_traps;                  // #NM exceptions taken
+    uint32_t saves;                     // FXSAVEs of an evicted owner
+    uint32_t restores;                  // FXRSTORs (saved image or initial state)
+} fpu_stats_t;
+
+void fpu_init(void);
+bool fpu_sse_enabled(void);
+void fpu_switch(fpu_context_t *context);
+void fpu_irq_enter(void);
+void fpu_irq_exit(void);
+void fpu_softirq_enter(void);
+void fpu_softirq_exit(void);
+bool fpu_handle_nm(void);
+void fpu_get_stats(fpu_stats_t *stats);
+
+#endif
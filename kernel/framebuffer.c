@@ -0,0 +1,86 @@
+/**
+ * framebuffer.c
+ *
+ * Framebuffer Console Setup
+ *
+ * Built with `make VBE=1`, the boot loader switches to a VBE linear
+ * framebuffer mode and records it, along with the BIOS 8x16 font, in
+ * BOOT_INFO (see boot/vbe.asm). This file hands that mode to the
+ * framebuffer console (drivers/fbcon.c) and keeps the framebuffer
+ * reachable once paging is on.
+ *
+ * --------------------------------------------------------------------
+ * ORDER
+ * --------------------------------------------------------------------
+ *
+ *   framebuffer_init()  right after boot_info_init(), so every message
+ *                       is drawn; paging is still off and the
+ *                       framebuffer is reached by its physical address.
+ *   framebuffer_map()   after pmm_init() (page tables come from the
+ *                       PMM) and before vmm_init(). The framebuffer
+ *                       lies above the identity-mapped RAM, so its
+ *                       pages are identity-mapped here, while page
+ *                       tables are still reachable without paging;
+ *                       vmm_init() only adds the RAM mappings and the
+ *                       console keeps working when paging is enabled.
+ *
+ */
+
+#include "framebuffer.h"
+#include "boot_info.h"
+#include "fbcon.h"
+#include "kprintf.h"
+#include "pmm.h"
+#include "vmm.h"
+
+/**
+ * @brief Switch console output to the boot loader's framebuffer, if any.
+ */
+void framebuffer_init(void)
+{
+    const boot_info_t *info = BOOT_INFO;
+
+    if (!info->fb_addr)
+    {
+        return;                         // Text mode (or a Multiboot loader)
+    }
+
+    fbcon_mode_t mode = {
+        .addr = info->fb_addr,
+        .pitch = info->fb_pitch,
+        .width = info->fb_width,
+        .height = info->fb_height,
+        .bpp = info->fb_bpp,
+        .font = (const uint8_t *) info->font_addr,
+    };
+
+    fbcon_init(&mode);
+}
+
+/**
+ * @brief Identity-map the framebuffer ahead of vmm_init().
+ */
+void framebuffer_map(void)
+{
+    const boot_info_t *info = BOOT_INFO;
+
+    if (!fbcon_active())
+    {
+        return;
+    }
+
+    uint32_t start = info->fb_addr & ~(PAGE_SIZE - 1);
+    uint32_t end = info->fb_addr + info->fb_pitch * info->fb_height;
+
+    for (uint32_t addr = start; addr < end; addr += PAGE_SIZE)
+    {
+        if (!vmm_map(addr, addr, VMM_WRITE))
+        {
+            break;                      // Inside the identity range already
+        }
+    }
+
+    kprintf("Framebuffer: %ux%ux%u at 0x%x, %ux%u text\n",
+            info->fb_width, info->fb_height, info->fb_bpp, info->fb_addr,
+            fbcon_cols(), fbcon_rows());
+}
@@ -0,0 +1,7 @@
+#ifndef FRAMEBUFFER_H_
+#define FRAMEBUFFER_H_
+
+void framebuffer_init(void);
+void framebuffer_map(void);
+
+#endif
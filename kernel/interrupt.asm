@@ -14,8 +14,17 @@ isr_stub_%+%1:
     jmp isr_common_stub
 %endmacro
 
+; Macro for hardware IRQs: lean entry, see irq_common_stub
+%macro irq_stub 1
+isr_stub_%+%1:
+    push eax
+    mov eax, %1 - 32            ; IRQ number
+    jmp irq_common_stub
+%endmacro
+
 isr_common_stub:
     pushad
+    cld                         ; C code (memcpy & co.) expects DF clear
 
     push ds
     push es
@@ -44,7 +53,58 @@ isr_common_stub:
     iret
 
 
+; Hardware IRQs run far more often than exceptions and need no frame
+; for a panic report, so only the registers a C call may clobber (EAX,
+; ECX, EDX) are saved and irq_entry(irq) is called directly. There is
+; no error code or vector to push and pop. The data segments are only
+; reloaded if the IRQ interrupted code outside ring 0; kernel code
+; already runs on the flat 0x10 selectors.
+irq_common_stub:
+    push ecx
+    push edx
+    cld                         ; C code (memcpy & co.) expects DF clear
+
+    test byte [esp + 16], 3     ; RPL of the interrupted CS (above EDX, ECX, EAX, EIP)
+    jnz .other_ring
+
+    push eax
+    call irq_entry
+    add esp, 4
+
+    pop edx
+    pop ecx
+    pop eax
+    iret
+
+.other_ring:
+    push ds
+    push es
+    push fs
+    push gs
+
+    mov cx, 0x10
+    mov ds, cx
+    mov es, cx
+    mov fs, cx
+    mov gs, cx
+
+    push eax
+    call irq_entry
+    add esp, 4
+
+    pop gs
+    pop fs
+    pop es
+    pop ds
+
+    pop edx
+    pop ecx
+    pop eax
+    iret
+
+
 extern exception_handler
+extern irq_entry
 
 ; CPU Exception Handlers (0-31)
 isr_no_err_stub 0   ; Division By Zero
@@ -81,22 +141,28 @@ isr_err_stub    30  ; Security Exception
 isr_no_err_stub 31  ; Reserved
 
 ; Hardware IRQ Handlers (32-47)
-isr_no_err_stub 32  ; IRQ0 - Timer
-isr_no_err_stub 33  ; IRQ1 - Keyboard
-isr_no_err_stub 34  ; IRQ2 - Cascade
-isr_no_err_stub 35  ; IRQ3 - COM2
-isr_no_err_stub 36  ; IRQ4 - COM1
-isr_no_err_stub 37  ; IRQ5 - LPT2
-isr_no_err_stub 38  ; IRQ6 - Floppy
-isr_no_err_stub 39  ; IRQ7 - Spurious
-isr_no_err_stub 40  ; IRQ8 - RTC
-isr_no_err_stub 41  ; IRQ9
-isr_no_err_stub 42  ; IRQ10
-isr_no_err_stub 43  ; IRQ11
-isr_no_err_stub 44  ; IRQ12 - Mouse
-isr_no_err_stub 45  ; IRQ13 - FPU
-isr_no_err_stub 46  ; IRQ14 - ATA Primary
-isr_no_err_stub 47  ; IRQ15 - ATA Secondary
+irq_stub        32  ; IRQ0 - Timer
+irq_stub        33  ; IRQ1 - Keyboard
+irq_stub        34  ; IRQ2 - Cascade
+irq_stub        35  ; IRQ3 - COM2
+irq_stub        36  ; IRQ4 - COM1
+irq_stub        37  ; IRQ5 - LPT2
+irq_stub        38  ; IRQ6 - Floppy
+irq_stub        39  ; IRQ7 - Spurious
+irq_stub        40  ; IRQ8 - RTC
+irq_stub        41  ; IRQ9
+irq_stub        42  ; IRQ10
+irq_stub        43  ; IRQ11
+irq_stub        44  ; IRQ12 - Mouse
+irq_stub        45  ; IRQ13 - FPU
+irq_stub        46  ; IRQ14 - ATA Primary
+irq_stub        47  ; IRQ15 - ATA Secondary
+
+; Local APIC spurious-interrupt vector (see apic.c): it must not be
+; acknowledged with an EOI and needs no handler, so it returns at once.
+global isr_stub_apic_spurious
+isr_stub_apic_spurious:
+    iret
 
 ; Export the ISR stub table
 global isr_stub_table
@@ -0,0 +1,79 @@
+/**
+ * irq_bench.c
+ *
+ * Interrupt Path Benchmark
+ *
+ * Booting with `irqbench` measures, in TSC cycles, the interrupt path
+ * of whichever controller is in use; boot once more with `irqbench
+ * nolapic` to get the 8259 figures for comparison:
+ *
+ *     eoi    - one controller EOI on its own (port writes on the PIC,
+ *              one MMIO write on the local APIC)
+ *     path   - a full round trip through an IRQ vector: `int` into the
+ *              lean IRQ stub, irq_entry(), irq_dispatch(), EOI, `iret`
+ *     frame  - the same through the full-frame exception stub (pushad,
+ *              segment reloads, exception_handler()), without an EOI;
+ *              path - eoi against frame compares the two entry paths
+ *
+ * The round trip uses the vector of BENCH_IRQ (COM2), which has no
+ * handler, so every call adds to that line's unhandled count. Nothing
+ * is in service while either runs, so the extra EOIs are harmless.
+ * The frame test borrows BENCH_VECTOR, which Intel reserves and the
+ * CPU never raises, with a handler that does nothing.
+ *
+ */
+
+#include "irq_bench.h"
+#include "cpu.h"
+#include "isr.h"
+#include "kprintf.h"
+#include "math.h"
+
+#include <stdint.h>
+
+#define BENCH_RUNS 256
+#define BENCH_IRQ 3
+#define BENCH_VECTOR 15
+
+static bool bench_nop(uint32_t vector, uint32_t error_code)
+{
+    (void)vector;
+    (void)error_code;
+    return true;
+}
+
+void irq_benchmark(void)
+{
+    const irq_controller_t *controller = irq_get_controller();
+    uint32_t flags = cpu_irq_save();
+
+    uint64_t start = cpu_rdtsc();
+    for (int i = 0; i < BENCH_RUNS; i++)
+    {
+        controller->eoi(BENCH_IRQ);
+    }
+    uint64_t eoi = cpu_rdtsc() - start;
+
+    start = cpu_rdtsc();
+    for (int i = 0; i < BENCH_RUNS; i++)
+    {
+        __asm__ volatile ("int %0" : : "i"(IRQ_BASE + BENCH_IRQ) : "memory");
+    }
+    uint64_t path = cpu_rdtsc() - start;
+
+    isr_register(BENCH_VECTOR, bench_nop);
+    start = cpu_rdtsc();
+    for (int i = 0; i < BENCH_RUNS; i++)
+    {
+        __asm__ volatile ("int %0" : : "i"(BENCH_VECTOR) : "memory");
+    }
+    uint64_t frame = cpu_rdtsc() - start;
+    isr_register(BENCH_VECTOR, NULL);
+
+    cpu_irq_restore(flags);
+
+    kprintf("irqbench (%s): eoi %u cycles, path %u cycles, frame %u cycles\n", controller->name,
+            (uint32_t)udivmod64(eoi, BENCH_RUNS, NULL),
+            (uint32_t)udivmod64(path, BENCH_RUNS, NULL),
+            (uint32_t)udivmod64(frame, BENCH_RUNS, NULL));
+}
@@ -0,0 +1,6 @@
+#ifndef IRQ_BENCH_H_
+#define IRQ_BENCH_H_
+
+void irq_benchmark(void);
+
+#endif
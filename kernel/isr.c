@@ -1,8 +1,107 @@
+/**
+ * isr.c
+ *
+ * Interrupt Dispatch
+ *
+ * CPU exceptions arrive through the full-frame stub in interrupt.asm
+ * at exception_handler(), which makes one indexed call through
+ * `isr_handlers[vector]`. Vectors without a handler, or whose handler
+ * returns false, panic. Hardware IRQs take a lean stub straight to
+ * irq_entry(); no chain of comparisons on either path.
+ *
+ * --------------------------------------------------------------------
+ * HARDWARE IRQS
+ * --------------------------------------------------------------------
+ *
+ * irq_entry() calls irq_dispatch(), which runs the handlers
+ * registered for the line with irq_register() and then sends the EOI
+ * through the current irq_controller_t (the 8259 PICs until
+ * apic_init() switches to the APICs), so drivers never do. Handlers on
+ * a shared line are all called in registration order (an edge may
+ * stand for several devices); one that finds its device idle returns
+ * false. If any claims the interrupt, the line's bottom half
+ * (SOFTIRQ_IRQ(irq), see softirq.c) is raised and runs once the EOI
+ * has been sent, with interrupts enabled again.
+ *
+ * On the PICs, IRQ7 and IRQ15 are also what they deliver when a
+ * request goes away before it is acknowledged. Such a spurious IRQ has
+ * no bit set in the in-service register; it is counted and gets no
+ * EOI, except that a spurious IRQ15 still needs one for the cascade
+ * line on the master PIC. The local APIC has a vector of its own for
+ * spurious interrupts instead (see apic.c). Spurious and unhandled
+ * IRQs are also reported through klog(), which is safe here.
+ *
+ * --------------------------------------------------------------------
+ * STATISTICS
+ * --------------------------------------------------------------------
+ *
+ * exception_handler() and irq_entry() read the TSC before calling the
+ * handler and again when it returns; for an IRQ that is from entry to
+ * just after the EOI. Per vector it keeps the count, min/max/total cycles and a
+ * histogram with one bucket per power of two, so a storm shows up as
+ * a count and a slow handler as a long tail. isr_print_stats() prints
+ * them much like /proc/interrupts (boot parameter `irqstats`, and on
+ * every panic). The assembly stub and the register save around the
+ * call are not included.
+ *
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 #include "../drivers/screen.h"
 #include "../lib/kprintf.h"
 #include "../drivers/pic.h"
-#include "../drivers/keyboard.h"
+#include "cpu.h"
+#include "fpu.h"
+#include "isr.h"
+#include "klog.h"
+#include "math.h"
+#include "softirq.h"
+
+#define IRQ_CASCADE 2
+#define IRQ_SPURIOUS_MASTER 7
+#define IRQ_SPURIOUS_SLAVE 15
+
+typedef struct irq_action irq_action_t;
+
+struct irq_action {
+    irq_handler_t handler;
+    void *ctx;
+    irq_action_t *next;                 // Next handler on the same line
+};
+
+static bool device_not_available(uint32_t vector, uint32_t error_code);
+
+static isr_handler_t isr_handlers[ISR_VECTORS] =
+{
+    [7] = device_not_available,
+};
+
+static irq_action_t *irq_actions[IRQ_LINES];
+static irq_action_t action_pool[IRQ_ACTIONS_MAX];
+static uint32_t actions_used;
+static irq_stats_t stats;
+
+static bool pic_spurious(uint8_t irq);
+
+static const irq_controller_t pic_controller =
+{
+    .name = "8259 PIC",
+    .unmask = pic_irq_clear_mask,
+    .mask = pic_irq_set_mask,
+    .eoi = pic_send_eoi,
+    .spurious = pic_spurious,
+};
+
+static const irq_controller_t *controller = &pic_controller;
+static isr_vector_stats_t vector_stats[ISR_VECTORS];
+
+static const char *irq_names[IRQ_LINES] =
+{
+    "timer", "keyboard", "cascade", "COM2", "COM1", "LPT2", "floppy", "LPT1",
+    "RTC", "", "", "", "mouse", "FPU", "ATA primary", "ATA secondary",
+};
 
 // Exception names for better debugging
 static const char* exception_messages[] =
@@ -41,28 +140,313 @@ static const char* exception_messages[] =
     "Reserved"
 };
 
-void exception_handler(uint32_t error_code, uint32_t interrupt_num)
+/**
+ * @brief Install the handler for an exception vector.
+ *
+ * @param vector  Exception vector (0-31).
+ * @param handler Called with the vector and error code; NULL removes it.
+ *
+ * @return false if @p vector is not an exception vector.
+ */
+bool isr_register(uint8_t vector, isr_handler_t handler)
 {
-    // Note: Parameters are reversed on stack (interrupt_num is pushed last)
-    // So we declare them reversed: error_code, interrupt_num
-    if (interrupt_num == 33)
+    if (vector >= IRQ_BASE)
+    {
+        return false;                   // IRQs go through irq_register()
+    }
+
+    isr_handlers[vector] = handler;
+    return true;
+}
+
+/**
+ * @brief Add a handler to a hardware IRQ line and unmask it.
+ *
+ * @param irq     IRQ line (0-15).
+ * @param handler Called from interrupt context, before the EOI.
+ * @param ctx     Passed to @p handler.
+ *
+ * @return false if @p irq is out of range or all IRQ_ACTIONS_MAX
+ *         handler slots are taken.
+ */
+bool irq_register(uint8_t irq, irq_handler_t handler, void *ctx)
+{
+    if (irq >= IRQ_LINES || !handler)
+    {
+        return false;
+    }
+
+    uint32_t flags = cpu_irq_save();
+    if (actions_used == IRQ_ACTIONS_MAX)
+    {
+        cpu_irq_restore(flags);
+        return false;
+    }
+
+    irq_action_t *action = &action_pool[actions_used++];
+    action->handler = handler;
+    action->ctx = ctx;
+    action->next = NULL;
+
+    irq_action_t **link = &irq_actions[irq];
+    while (*link)
+    {
+        link = &(*link)->next;
+    }
+    *link = action;
+
+    controller->unmask(irq);
+    cpu_irq_restore(flags);
+    return true;
+}
+
+/**
+ * @brief Switch IRQ delivery to another interrupt controller.
+ *
+ * Lines that have handlers are unmasked on the new controller; taking
+ * the old one out of service is the caller's job.
+ */
+void irq_set_controller(const irq_controller_t *new_controller)
+{
+    uint32_t flags = cpu_irq_save();
+
+    controller = new_controller;
+    for (uint8_t irq = 0; irq < IRQ_LINES; irq++)
+    {
+        if (irq_actions[irq])
+        {
+            controller->unmask(irq);
+        }
+    }
+
+    cpu_irq_restore(flags);
+}
+
+const irq_controller_t *irq_get_controller(void)
+{
+    return controller;
+}
+
+/**
+ * @brief Get the spurious and unhandled IRQ counters.
+ *
+ * @param out Receives a copy of the counters.
+ */
+void irq_get_stats(irq_stats_t *out)
+{
+    *out = stats;
+}
+
+/**
+ * @brief Check for a spurious PIC IRQ7/IRQ15 and send the EOI it needs.
+ *
+ * @return true if @p irq was spurious and must not be handled.
+ */
+static bool pic_spurious(uint8_t irq)
+{
+    if (irq != IRQ_SPURIOUS_MASTER && irq != IRQ_SPURIOUS_SLAVE)
+    {
+        return false;
+    }
+    if (pic_get_isr() & (1u << irq))
+    {
+        return false;
+    }
+
+    if (irq == IRQ_SPURIOUS_SLAVE)
+    {
+        pic_send_eoi(IRQ_CASCADE);      // The master did see a real IRQ2
+    }
+    return true;
+}
+
+/**
+ * @brief Log a spurious or unhandled IRQ from interrupt context.
+ *
+ * Only the 1st, 2nd, 4th, 8th... occurrence on a line is logged, so a
+ * storm costs a few ring records rather than one per interrupt. The
+ * formatting may use the SSE memops, hence the FPU context switch.
+ *
+ * @param what  "spurious" or "unhandled".
+ * @param irq   IRQ line, 0-15.
+ * @param count Occurrences on @p irq so far, this one included.
+ */
+static void irq_report(const char *what, uint8_t irq, uint32_t count)
+{
+    if (count & (count - 1))
+    {
+        return;
+    }
+    fpu_irq_enter();
+    klog(KLOG_WARNING, "irq: %s IRQ%u, %u so far\n", what, irq, count);
+    fpu_irq_exit();
+}
+
+/**
+ * @brief Run the handlers of an IRQ line and acknowledge it.
+ */
+static void irq_dispatch(uint8_t irq)
+{
+    if (controller->spurious && controller->spurious(irq))
     {
-        keyboard_handler();
-        pic_send_eoi(1);  // Send EOI for IRQ1
+        irq_report("spurious", irq, ++stats.spurious[irq]);
         return;
     }
-    if (interrupt_num >= 32 && interrupt_num <= 47)
+
+    bool handled = false;
+    fpu_irq_enter();
+    for (irq_action_t *action = irq_actions[irq]; action; action = action->next)
+    {
+        handled |= action->handler(action->ctx);
+    }
+    fpu_irq_exit();
+
+    if (handled)
+    {
+        softirq_raise(SOFTIRQ_IRQ(irq));
+    }
+    else
+    {
+        irq_report("unhandled", irq, ++stats.unhandled[irq]);
+    }
+    controller->eoi(irq);
+}
+
+/**
+ * @brief #NM: lazy FPU switch (see fpu.c).
+ */
+static bool device_not_available(uint32_t vector, uint32_t error_code)
+{
+    (void)vector;
+    (void)error_code;
+    return fpu_handle_nm();
+}
+
+/**
+ * @brief Account one dispatch of @p vector that took @p cycles.
+ */
+static inline void vector_account(uint32_t vector, uint32_t cycles)
+{
+    isr_vector_stats_t *vs = &vector_stats[vector];
+
+    if (!vs->count++ || cycles < vs->min_cycles)
+    {
+        vs->min_cycles = cycles;
+    }
+    if (cycles > vs->max_cycles)
+    {
+        vs->max_cycles = cycles;
+    }
+    vs->total_cycles += cycles;
+    vs->hist[cycles ? 31 - __builtin_clz(cycles) : 0]++;
+}
+
+/**
+ * @brief Get the dispatch statistics of one vector.
+ *
+ * @param vector Vector number (below ISR_VECTORS).
+ * @param out    Receives a copy; zeroed for other vectors.
+ */
+void isr_get_vector_stats(uint8_t vector, isr_vector_stats_t *out)
+{
+    if (vector >= ISR_VECTORS)
     {
-        uint8_t irq = interrupt_num - 32;
-        // TODO: dispatch to device handlers
-        pic_send_eoi(irq);
+        *out = (isr_vector_stats_t) { 0 };
         return;
     }
-    kprintf("\n\n=== KERNEL PANIC ===\n");
-    kprintf("Exception: %s (#%d)\n", 
-            exception_messages[interrupt_num], 
-            interrupt_num);
-    kprintf("Error Code: 0x%x\n", error_code);
+
+    uint32_t flags = cpu_irq_save();
+    *out = vector_stats[vector];
+    cpu_irq_restore(flags);
+}
+
+/**
+ * @brief Print one line per vector that has fired, with its histogram.
+ */
+void isr_print_stats(void)
+{
+    kprintf("Interrupts (%s), cycles from entry to return:\n", controller->name);
+    kprintf(" vec  irq      count      min      avg      max  name\n");
+
+    for (uint32_t vector = 0; vector < ISR_VECTORS; vector++)
+    {
+        isr_vector_stats_t vs;
+        isr_get_vector_stats(vector, &vs);
+        if (!vs.count)
+        {
+            continue;
+        }
+
+        uint32_t avg = (uint32_t)udivmod64(vs.total_cycles, vs.count, NULL);
+        if (vector >= IRQ_BASE)
+        {
+            uint32_t irq = vector - IRQ_BASE;
+            kprintf(" %3u  %3u %10u %8u %8u %8u  %s", vector, irq, vs.count,
+                    vs.min_cycles, avg, vs.max_cycles, irq_names[irq]);
+            if (stats.spurious[irq] || stats.unhandled[irq])
+            {
+                kprintf(" (%u spurious, %u unhandled)", stats.spurious[irq], stats.unhandled[irq]);
+            }
+            kprintf("\n");
+        }
+        else
+        {
+            kprintf(" %3u    - %10u %8u %8u %8u  %s\n", vector, vs.count,
+                    vs.min_cycles, avg, vs.max_cycles, exception_messages[vector]);
+        }
+
+        // Cycles as powers of two: "2^10:5" is 5 calls of 1024..2047 cycles
+        kprintf("            ");
+        for (uint32_t bucket = 0; bucket < ISR_HIST_BUCKETS; bucket++)
+        {
+            if (vs.hist[bucket])
+            {
+                kprintf(" 2^%u:%u", bucket, vs.hist[bucket]);
+            }
+        }
+        kprintf("\n");
+    }
+}
+
+/**
+ * @brief Entry from the IRQ stubs (irq_common_stub in interrupt.asm).
+ *
+ * @param irq IRQ line, 0-15.
+ */
+void irq_entry(uint32_t irq)
+{
+    uint64_t entry = cpu_rdtsc();
+    irq_dispatch(irq);
+    vector_account(IRQ_BASE + irq, (uint32_t)(cpu_rdtsc() - entry));
+
+    softirq_run();                      // Bottom halves, interrupts enabled
+}
+
+/**
+ * @brief kprintf()-shaped front end to kvlog() at KLOG_EMERG.
+ */
+static void panic_log(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    kvlog(KLOG_EMERG, fmt, args);
+    va_end(args);
+}
+
+/**
+ * @brief Describe the exception that is about to halt the kernel.
+ *
+ * @param print panic_log() to queue the report in the log ring, or
+ *              kprintf() to print it directly.
+ */
+static void panic_report(void (*print)(const char *fmt, ...),
+                         uint32_t interrupt_num, uint32_t error_code)
+{
+    print("=== KERNEL PANIC ===\n");
+    print("Exception: %s (#%u)\n",
+          exception_messages[interrupt_num],
+          interrupt_num);
+    print("Error Code: 0x%x\n", error_code);
     
     // Additional info for specific exceptions
     if (interrupt_num == 14)
@@ -70,10 +454,37 @@ void exception_handler(uint32_t error_code, uint32_t interrupt_num)
         // Page Fault
         uint32_t cr2;
         __asm__ volatile ("mov %%cr2, %0" : "=r"(cr2));
-        kprintf("Faulting Address (CR2): 0x%x\n", cr2);
+        print("Faulting Address (CR2): 0x%x\n", cr2);
     }
     
-    kprintf("\nSystem Halted.\n");
+    print("System Halted.\n");
+}
+
+void exception_handler(uint32_t error_code, uint32_t interrupt_num)
+{
+    // Note: Parameters are reversed on stack (interrupt_num is pushed last)
+    // So we declare them reversed: error_code, interrupt_num
+    uint64_t entry = cpu_rdtsc();
+    isr_handler_t handler = interrupt_num < ISR_VECTORS ? isr_handlers[interrupt_num] : NULL;
+    if (handler && handler(interrupt_num, error_code))
+    {
+        vector_account(interrupt_num, (uint32_t)(cpu_rdtsc() - entry));
+        return;
+    }
+
+    klog_stats_t before, after;
+    klog_get_stats(&before);
+    panic_report(panic_log, interrupt_num, error_code);
+    kprintf("\n");
+    klog_panic();
+
+    // A full ring dropped (part of) the report: print it directly
+    klog_get_stats(&after);
+    if (after.dropped != before.dropped)
+    {
+        panic_report(kprintf, interrupt_num, error_code);
+    }
+    isr_print_stats();
     
     __asm__ volatile ("cli; hlt");
     while(1);  // Prevent compiler warnings
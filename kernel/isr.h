@@ -0,0 +1,59 @@
+#ifndef ISR_H_
+#define ISR_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ISR_VECTORS 48                  // Vectors with a stub in interrupt.asm
+#define IRQ_BASE 32                     // Vector of IRQ0 (PIC and I/O APIC alike)
+#define IRQ_LINES 16
+#define IRQ_ACTIONS_MAX 32              // Registered IRQ handlers, all lines together
+
+/**
+ * Exception handler: returns true if it resolved the exception and the
+ * interrupted code may continue, false to panic.
+ */
+typedef bool (*isr_handler_t)(uint32_t vector, uint32_t error_code);
+
+/**
+ * IRQ handler: returns true if its device raised the interrupt, so
+ * handlers sharing a line can tell whose it was.
+ */
+typedef bool (*irq_handler_t)(void *ctx);
+
+/**
+ * Interrupt controller operations used by the IRQ dispatcher: the 8259
+ * PIC pair by default, the local and I/O APIC after apic_init().
+ */
+typedef struct {
+    const char *name;
+    void (*unmask)(uint8_t irq);
+    void (*mask)(uint8_t irq);
+    void (*eoi)(uint8_t irq);
+    bool (*spurious)(uint8_t irq);      // Filter run before the handlers; may be NULL
+} irq_controller_t;
+
+#define ISR_HIST_BUCKETS 32             // Bucket n: handler took [2^n, 2^(n+1)) cycles
+
+typedef struct {
+    uint32_t count;                     // Times the vector was dispatched
+    uint32_t min_cycles;                // Fastest entry-to-return (entry-to-EOI for IRQs)
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+    uint32_t hist[ISR_HIST_BUCKETS];    // log2 latency histogram
+} isr_vector_stats_t;
+
+typedef struct {
+    uint32_t spurious[IRQ_LINES];       // IRQ7/IRQ15 with no in-service bit
+    uint32_t unhandled[IRQ_LINES];      // Raised with no handler claiming it
+} irq_stats_t;
+
+bool isr_register(uint8_t vector, isr_handler_t handler);
+bool irq_register(uint8_t irq, irq_handler_t handler, void *ctx);
+void irq_get_stats(irq_stats_t *stats);
+void irq_set_controller(const irq_controller_t *controller);
+const irq_controller_t *irq_get_controller(void);
+void isr_get_vector_stats(uint8_t vector, isr_vector_stats_t *stats);
+void isr_print_stats(void);
+
+#endif
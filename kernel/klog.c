@@ -0,0 +1,322 @@
+/**
+ * klog.c
+ *
+ * Kernel Log Ring Buffer
+ *
+ * klog() records a timestamped, levelled message in a ring buffer and
+ * returns; it never touches a console. klog_drain(), called from the
+ * idle loop, prints the records in order. Interrupt handlers can
+ * therefore log without waiting for VGA memory or port I/O.
+ *
+ * --------------------------------------------------------------------
+ * RECORDS
+ * --------------------------------------------------------------------
+ *
+ * A record is a klog_record_t header followed by the message text,
+ * padded to 8 bytes. Records never wrap: if one doesn't fit before
+ * the end of the ring, the gap is filled with a padding record and
+ * the message starts at offset 0.
+ *
+ * `log_head` (next free byte) and `log_tail` (oldest record not yet
+ * drained) are free-running byte counters; the ring offset is the low
+ * bits. The ring is full when head - tail would exceed its size, in
+ * which case the new message is dropped and counted.
+ *
+ * --------------------------------------------------------------------
+ * PRODUCERS
+ * --------------------------------------------------------------------
+ *
+ * Any context may log, including interrupt handlers that interrupt
+ * another producer or the consumer. A producer:
+ *
+ *     1. formats the message on its own stack (kvsnprintf),
+ *     2. reserves space by advancing log_head with a compare-exchange,
+ *        retried if another producer got in first,
+ *     3. copies header and text into its space,
+ *     4. sets the header's state to committed, last.
+ *
+ * No lock is taken and interrupts stay enabled throughout.
+ *
+ * --------------------------------------------------------------------
+ * CONSUMER
+ * --------------------------------------------------------------------
+ *
+ * There is one consumer: klog_drain() from the idle loop, or
+ * klog_panic() once nothing else will run. It stops at the first
+ * record that is reserved but not yet committed, so output stays in
+ * order. Consumed records are zeroed before log_tail moves past them,
+ * so a header the consumer later finds there reads "uncommitted" until
+ * its producer has finished with it.
+ *
+ * Records above the console level are consumed without being printed.
+ *
+ * The exception handler logs its panic report here too, but prints it
+ * again directly after klog_panic() if the ring dropped any of it.
+ *
+ */
+
+#include "klog.h"
+#include "kprintf.h"
+#include "ktime.h"
+#include "math.h"
+#include "memory.h"
+#include "screen.h"
+
+#include <stddef.h>
+
+#define RECORD_ALIGN 8
+#define RING_MASK (KLOG_BUFFER_SIZE - 1)
+
+#define STATE_EMPTY     0               // Free, or reserved and still being written
+#define STATE_COMMITTED 1
+#define STATE_PADDING   2               // Committed filler up to the end of the ring
+
+typedef struct {
+    uint32_t size;                      // Bytes to the next record, header included
+    uint32_t state;                     // STATE_*; set last by the producer
+    uint64_t tsc;                       // ktime_get_cycles() when logged
+    uint16_t len;                       // Text length
+    uint8_t level;                      // KLOG_*
+    uint8_t reserved;
+    char text[];
+} klog_record_t;
+
+__attribute__((aligned(RECORD_ALIGN)))
+static uint8_t log_ring[KLOG_BUFFER_SIZE];
+
+static uint32_t log_head;               // Next byte to reserve
+static uint32_t log_tail;               // Oldest record not yet drained
+
+static uint32_t console_level = KLOG_INFO;
+
+static klog_stats_t stats;
+static uint32_t dropped_reported;
+
+static const char *level_names[] = { "EMERG", "ALERT", "CRIT", "ERR", "WARN", "NOTICE", "INFO", "DEBUG" };
+
+/**
+ * @brief Set the most verbose level that reaches the console.
+ *
+ * @param level KLOG_* level; records above it stay off the console.
+ */
+void klog_set_console_level(uint32_t level)
+{
+    console_level = level;
+}
+
+/**
+ * @brief Reserve space for a record.
+ *
+ * @param size Record size in bytes, a multiple of RECORD_ALIGN.
+ *
+ * @return Pointer to the reserved record, or NULL if the ring is full.
+ */
+static klog_record_t *log_reserve(uint32_t size)
+{
+    uint32_t head = __atomic_load_n(&log_head, __ATOMIC_ACQUIRE);
+
+    for (;;)
+    {
+        uint32_t offset = head & RING_MASK;
+        uint32_t pad = KLOG_BUFFER_SIZE - offset < size ? KLOG_BUFFER_SIZE - offset : 0;
+        uint32_t next = head + pad + size;
+
+        if (next - __atomic_load_n(&log_tail, __ATOMIC_ACQUIRE) > KLOG_BUFFER_SIZE)
+        {
+            return NULL;
+        }
+
+        // On failure `head` is reloaded with the current value
+        if (__atomic_compare_exchange_n(&log_head, &head, next, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            if (pad)
+            {
+                klog_record_t *filler = (klog_record_t *) &log_ring[offset];
+                filler->size = pad;
+                __atomic_store_n(&filler->state, STATE_PADDING, __ATOMIC_RELEASE);
+                offset = 0;
+            }
+            return (klog_record_t *) &log_ring[offset];
+        }
+    }
+}
+
+/**
+ * @brief Log a message (va_list form of klog()).
+ */
+void kvlog(uint32_t level, const char *fmt, va_list args)
+{
+    char line[KLOG_LINE_MAX + 1];
+    uint64_t tsc = ktime_get_cycles();
+    int len = kvsnprintf(line, sizeof(line), fmt, args);
+
+    if (len > KLOG_LINE_MAX)
+    {
+        len = KLOG_LINE_MAX;
+    }
+    if (len > 0 && line[len - 1] == '\n')
+    {
+        len--;                          // Every record is printed as one line
+    }
+
+    uint32_t size = (sizeof(klog_record_t) + len + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1);
+    klog_record_t *record = log_reserve(size);
+    if (!record)
+    {
+        __atomic_fetch_add(&stats.dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    record->size = size;
+    record->tsc = tsc;
+    record->len = len;
+    record->level = level;
+    memcpy(record->text, line, len);
+    __atomic_store_n(&record->state, STATE_COMMITTED, __ATOMIC_RELEASE);
+
+    __atomic_fetch_add(&stats.logged, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Log a message.
+ *
+ * Safe from any context, including interrupt handlers. The message
+ * reaches the console at the next klog_drain().
+ *
+ * @param level KLOG_* level.
+ * @param fmt   kprintf() format; a trailing newline is optional.
+ */
+void klog(uint32_t level, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    kvlog(level, fmt, args);
+    va_end(args);
+}
+
+/**
+ * @brief Check whether records are waiting to be drained.
+ */
+bool klog_pending(void)
+{
+    return __atomic_load_n(&log_head, __ATOMIC_ACQUIRE) != __atomic_load_n(&log_tail, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Print one record to the console.
+ */
+static void log_print(const klog_record_t *record)
+{
+    uint32_t level = record->level < 8 ? record->level : KLOG_DEBUG;
+
+    if (ktime_tsc_khz())
+    {
+        uint32_t us_rem;
+        uint64_t us = udivmod64(ktime_cycles_to_ns(record->tsc), 1000, NULL);
+        uint32_t sec = (uint32_t) udivmod64(us, 1000000, &us_rem);
+        kprintf("[%5u.%06u] %s: %.*s\n", sec, us_rem, level_names[level], record->len, record->text);
+    }
+    else
+    {
+        kprintf("[%llu] %s: %.*s\n", record->tsc, level_names[level], record->len, record->text);
+    }
+}
+
+/**
+ * @brief Consume committed records, oldest first.
+ *
+ * @param all Print every record regardless of the console level.
+ */
+static void log_consume(bool all)
+{
+    uint32_t dropped = __atomic_load_n(&stats.dropped, __ATOMIC_RELAXED);
+    if (dropped != dropped_reported)
+    {
+        kprintf("klog: %u messages dropped (ring full)\n", dropped - dropped_reported);
+        dropped_reported = dropped;
+    }
+
+    for (;;)
+    {
+        uint32_t tail = __atomic_load_n(&log_tail, __ATOMIC_ACQUIRE);
+        if (tail == __atomic_load_n(&log_head, __ATOMIC_ACQUIRE))
+        {
+            break;
+        }
+
+        klog_record_t *record = (klog_record_t *) &log_ring[tail & RING_MASK];
+        uint32_t state = __atomic_load_n(&record->state, __ATOMIC_ACQUIRE);
+        if (state == STATE_EMPTY)
+        {
+            break;                      // Its producer hasn't finished yet
+        }
+
+        uint32_t size = record->size;
+        if (state == STATE_COMMITTED)
+        {
+            if (all || record->level <= console_level)
+            {
+                log_print(record);
+            }
+            stats.drained++;
+        }
+
+        memset(record, 0, size);
+        __atomic_store_n(&log_tail, tail + size, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * @brief Print pending records to the console.
+ *
+ * Called from the idle loop; must not be called from interrupt
+ * handlers (there is a single consumer).
+ */
+void klog_drain(void)
+{
+    if (klog_pending() || stats.dropped != dropped_reported)
+    {
+        log_consume(false);
+        screen_flush();
+    }
+}
+
+/**
+ * @brief Print everything still in the ring, for the panic path.
+ *
+ * Ignores the console level. A record whose producer was interrupted
+ * by the panic is reported and skipped if its size is known.
+ */
+void klog_panic(void)
+{
+    log_consume(true);
+
+    uint32_t tail = log_tail;
+    while (tail != log_head)
+    {
+        klog_record_t *record = (klog_record_t *) &log_ring[tail & RING_MASK];
+        if (record->size == 0 || record->size > KLOG_BUFFER_SIZE)
+        {
+            break;
+        }
+
+        kprintf("klog: incomplete record skipped\n");
+        tail += record->size;
+        log_tail = tail;
+        log_consume(true);
+        tail = log_tail;
+    }
+
+    screen_flush();
+}
+
+/**
+ * @brief Get the log counters.
+ *
+ * @param out Receives a copy of the counters.
+ */
+void klog_get_stats(klog_stats_t *out)
+{
+    *out = stats;
+}
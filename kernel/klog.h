@@ -0,0 +1,35 @@
+#ifndef KLOG_H_
+#define KLOG_H_
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Log levels, most severe first (as in syslog)
+#define KLOG_EMERG   0
+#define KLOG_ALERT   1
+#define KLOG_CRIT    2
+#define KLOG_ERR     3
+#define KLOG_WARNING 4
+#define KLOG_NOTICE  5
+#define KLOG_INFO    6
+#define KLOG_DEBUG   7
+
+#define KLOG_BUFFER_SIZE 16384          // Ring size in bytes (power of two)
+#define KLOG_LINE_MAX 200               // Longest message kept, excluding the header
+
+typedef struct {
+    uint32_t logged;                    // Records committed
+    uint32_t drained;                   // Records taken off the ring by the consumer
+    uint32_t dropped;                   // Records lost because the ring was full
+} klog_stats_t;
+
+void klog(uint32_t level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+void kvlog(uint32_t level, const char *fmt, va_list args);
+bool klog_pending(void);
+void klog_drain(void);
+void klog_panic(void);
+void klog_set_console_level(uint32_t level);
+void klog_get_stats(klog_stats_t *stats);
+
+#endif
@@ -0,0 +1,461 @@
+/**
+ * kmalloc.c
+ *
+ * Kernel Heap (slab allocator)
+ *
+ * --------------------------------------------------------------------
+ * SIZE CLASSES
+ * --------------------------------------------------------------------
+ *
+ * Requests up to 2 KiB are rounded up to a power of two and served by
+ * one of eight slab caches:
+ *     16, 32, 64, 128, 256, 512, 1024, 2048 bytes
+ *
+ * Larger requests take whole buddy blocks straight from the PMM
+ * (2^order pages) and are page aligned.
+ *
+ * --------------------------------------------------------------------
+ * SLABS
+ * --------------------------------------------------------------------
+ *
+ * A slab is one PMM block of 2^slab_order pages. Its first 64 bytes
+ * hold the slab header; objects follow back to back. Because the
+ * header fills exactly one cache line and object sizes are powers of
+ * two, objects of 64 bytes and up start on a cache line and smaller
+ * objects never straddle one.
+ *
+ * Each cache picks the smallest slab order (up to 8 pages) that wastes
+ * at most 1/8 of the slab on header and tail slack.
+ *
+ * Free objects form a singly linked list threaded through the objects
+ * themselves. A cache keeps its slabs on two lists:
+ *     partial : at least one free object (including empty slabs)
+ *     full    : no free objects
+ * kmalloc() pops from the first partial slab and kfree() pushes back
+ * onto the object's slab, so both are O(1). One empty slab per cache is
+ * kept around to absorb alloc/free ping-pong; further empty slabs go
+ * back to the PMM.
+ *
+ * --------------------------------------------------------------------
+ * FINDING THE OWNER OF A POINTER
+ * --------------------------------------------------------------------
+ *
+ * kfree() only gets a pointer. A byte per physical page (page_info[])
+ * records who owns it:
+ *     0x00            : not a kmalloc page
+ *     0x80 | order    : first page of a large allocation
+ *     page << 4 | idx : page `page` of a slab of cache `idx - 1`
+ *
+ * The heap relies on the identity mapping set up by vmm_init(), so
+ * physical addresses from the PMM are used directly as pointers.
+ *
+ */
+
+#include "kmalloc.h"
+#include "cpu.h"
+#include "kprintf.h"
+#include "math.h"
+#include "memory.h"
+#include "pmm.h"
+
+#include <stdbool.h>
+
+#define CACHE_LINE_SIZE     64
+#define SLAB_HEADER_SIZE    CACHE_LINE_SIZE
+#define SLAB_MAX_ORDER      3
+
+#define PAGE_INFO_LARGE     0x80
+#define PAGE_INFO_ORDER     0x0F
+#define PAGE_INFO_PAGE_SHIFT 4
+
+typedef struct kmem_cache kmem_cache_t;
+
+typedef struct slab {
+    struct slab *next;
+    struct slab *prev;
+    kmem_cache_t *cache;
+    void *free;                         // First free object
+    uint32_t in_use;
+} slab_t;
+
+struct kmem_cache {
+    uint32_t object_size;
+    uint32_t slab_order;
+    uint32_t objects_per_slab;
+    slab_t *partial;
+    slab_t *full;
+    uint32_t empty_slabs;
+    uint32_t objects_in_use;
+    uint32_t slabs;
+};
+
+_Static_assert(sizeof(slab_t) <= SLAB_HEADER_SIZE, "slab header must fit in one cache line");
+
+static kmem_cache_t caches[KMALLOC_CACHE_COUNT];
+static uint8_t *page_info;
+static uint32_t page_info_count;
+
+static uint32_t large_objects;
+static uint32_t large_pages;
+static uint64_t bytes_requested;
+static uint64_t bytes_allocated;
+
+/**
+ * @brief Smallest order such that 2^order >= value.
+ */
+static uint32_t order_for(uint32_t value)
+{
+    uint32_t order = 0;
+    while ((1u << order) < value)
+    {
+        order++;
+    }
+    return order;
+}
+
+static void slab_list_add(slab_t **list, slab_t *slab)
+{
+    slab->prev = NULL;
+    slab->next = *list;
+    if (*list)
+    {
+        (*list)->prev = slab;
+    }
+    *list = slab;
+}
+
+static void slab_list_remove(slab_t **list, slab_t *slab)
+{
+    if (slab->prev)
+    {
+        slab->prev->next = slab->next;
+    }
+    else
+    {
+        *list = slab->next;
+    }
+    if (slab->next)
+    {
+        slab->next->prev = slab->prev;
+    }
+}
+
+/**
+ * @brief Get a new slab from the PMM and thread its free list.
+ *
+ * @param cache Cache the slab belongs to.
+ *
+ * @return The slab, or NULL if physical memory is exhausted.
+ */
+static slab_t *slab_create(kmem_cache_t *cache)
+{
+    uint32_t addr = pmm_alloc_pages(cache->slab_order);
+    if (!addr)
+    {
+        return NULL;
+    }
+
+    slab_t *slab = (slab_t *)addr;
+    slab->cache = cache;
+    slab->in_use = 0;
+    slab->free = NULL;
+
+    // Thread objects so the lowest address is handed out first
+    uint8_t *objects = (uint8_t *)addr + SLAB_HEADER_SIZE;
+    for (uint32_t i = cache->objects_per_slab; i-- > 0;)
+    {
+        void **object = (void **)(objects + i * cache->object_size);
+        *object = slab->free;
+        slab->free = object;
+    }
+
+    uint32_t first_page = addr >> PAGE_SHIFT;
+    uint8_t cache_id = (uint8_t)(cache - caches) + 1;
+    for (uint32_t page = 0; page < (1u << cache->slab_order); page++)
+    {
+        page_info[first_page + page] = (uint8_t)(page << PAGE_INFO_PAGE_SHIFT) | cache_id;
+    }
+
+    cache->slabs++;
+    return slab;
+}
+
+static void slab_destroy(slab_t *slab)
+{
+    kmem_cache_t *cache = slab->cache;
+    uint32_t first_page = (uint32_t)slab >> PAGE_SHIFT;
+
+    for (uint32_t page = 0; page < (1u << cache->slab_order); page++)
+    {
+        page_info[first_page + page] = 0;
+    }
+
+    cache->slabs--;
+    pmm_free_pages((uint32_t)slab, cache->slab_order);
+}
+
+static void *cache_alloc(kmem_cache_t *cache)
+{
+    slab_t *slab = cache->partial;
+    if (!slab)
+    {
+        slab = slab_create(cache);
+        if (!slab)
+        {
+            return NULL;
+        }
+        slab_list_add(&cache->partial, slab);
+        cache->empty_slabs++;
+    }
+
+    void **object = slab->free;
+    slab->free = *object;
+
+    if (slab->in_use++ == 0)
+    {
+        cache->empty_slabs--;
+    }
+    if (!slab->free)
+    {
+        slab_list_remove(&cache->partial, slab);
+        slab_list_add(&cache->full, slab);
+    }
+
+    cache->objects_in_use++;
+    return object;
+}
+
+static void cache_free(slab_t *slab, void *ptr)
+{
+    kmem_cache_t *cache = slab->cache;
+
+    if (!slab->free)
+    {
+        slab_list_remove(&cache->full, slab);
+        slab_list_add(&cache->partial, slab);
+    }
+
+    *(void **)ptr = slab->free;
+    slab->free = ptr;
+    cache->objects_in_use--;
+
+    if (--slab->in_use == 0)
+    {
+        if (cache->empty_slabs > 0)
+        {
+            slab_list_remove(&cache->partial, slab);
+            slab_destroy(slab);
+        }
+        else
+        {
+            cache->empty_slabs++;
+        }
+    }
+}
+
+/**
+ * @brief Set up the size-class caches and the page owner table.
+ *
+ * Must run after vmm_init(): slabs are accessed through the identity
+ * mapping.
+ */
+void kmalloc_init(void)
+{
+    page_info_count = pmm_memory_end() >> PAGE_SHIFT;
+
+    uint32_t table_order = order_for((page_info_count + PAGE_SIZE - 1) >> PAGE_SHIFT);
+    page_info = (uint8_t *)pmm_alloc_pages(table_order);
+    if (!page_info)
+    {
+        kprintf("kmalloc: no memory for the page owner table, heap disabled\n");
+        page_info_count = 0;
+        return;
+    }
+    memset(page_info, 0, page_info_count);
+
+    for (uint32_t i = 0; i < KMALLOC_CACHE_COUNT; i++)
+    {
+        kmem_cache_t *cache = &caches[i];
+        cache->object_size = 1u << (KMALLOC_MIN_SHIFT + i);
+
+        for (cache->slab_order = 0; cache->slab_order < SLAB_MAX_ORDER; cache->slab_order++)
+        {
+            uint32_t slab_bytes = PAGE_SIZE << cache->slab_order;
+            uint32_t objects = (slab_bytes - SLAB_HEADER_SIZE) / cache->object_size;
+            uint32_t slack = slab_bytes - objects * cache->object_size;
+            if (slack <= slab_bytes / 8)
+            {
+                break;
+            }
+        }
+
+        uint32_t slab_bytes = PAGE_SIZE << cache->slab_order;
+        cache->objects_per_slab = (slab_bytes - SLAB_HEADER_SIZE) / cache->object_size;
+    }
+}
+
+/**
+ * @brief Allocate kernel memory.
+ *
+ * Sizes up to 2 KiB come from the matching slab cache and are aligned
+ * to their size class (at most a cache line). Larger sizes are page
+ * aligned. Safe to call with interrupts enabled or disabled.
+ *
+ * @param size Number of bytes.
+ *
+ * @return Pointer to the memory, or NULL if @p size is 0, larger than
+ *         the biggest buddy block, or memory is exhausted.
+ */
+void *kmalloc(size_t size)
+{
+    if (size == 0 || size > (PAGE_SIZE << PMM_MAX_ORDER) || !page_info)
+    {
+        return NULL;
+    }
+
+    void *ptr = NULL;
+    uint32_t granted;
+    uint32_t flags = cpu_irq_save();
+
+    if (size <= (1u << KMALLOC_MAX_SHIFT))
+    {
+        uint32_t shift = order_for(size);
+        if (shift < KMALLOC_MIN_SHIFT)
+        {
+            shift = KMALLOC_MIN_SHIFT;
+        }
+
+        kmem_cache_t *cache = &caches[shift - KMALLOC_MIN_SHIFT];
+        ptr = cache_alloc(cache);
+        granted = cache->object_size;
+    }
+    else
+    {
+        uint32_t order = order_for((size + PAGE_SIZE - 1) >> PAGE_SHIFT);
+        uint32_t addr = pmm_alloc_pages(order);
+        if (addr)
+        {
+            page_info[addr >> PAGE_SHIFT] = PAGE_INFO_LARGE | order;
+            large_objects++;
+            large_pages += 1u << order;
+            ptr = (void *)addr;
+        }
+        granted = PAGE_SIZE << order;
+    }
+
+    if (ptr)
+    {
+        bytes_requested += size;
+        bytes_allocated += granted;
+    }
+
+    cpu_irq_restore(flags);
+    return ptr;
+}
+
+/**
+ * @brief Free memory obtained from kmalloc().
+ *
+ * @param ptr Pointer returned by kmalloc(), or NULL (ignored).
+ */
+void kfree(void *ptr)
+{
+    if (!ptr)
+    {
+        return;
+    }
+
+    uint32_t page = (uint32_t)ptr >> PAGE_SHIFT;
+    uint8_t info = page < page_info_count ? page_info[page] : 0;
+
+    if (info == 0)
+    {
+        kprintf("kfree: 0x%x was not allocated by kmalloc\n", (uint32_t)ptr);
+        return;
+    }
+
+    uint32_t flags = cpu_irq_save();
+
+    if (info & PAGE_INFO_LARGE)
+    {
+        uint32_t order = info & PAGE_INFO_ORDER;
+        page_info[page] = 0;
+        large_objects--;
+        large_pages -= 1u << order;
+        pmm_free_pages((uint32_t)ptr, order);
+    }
+    else
+    {
+        uint32_t slab_page = page - (info >> PAGE_INFO_PAGE_SHIFT);
+        cache_free((slab_t *)(slab_page << PAGE_SHIFT), ptr);
+    }
+
+    cpu_irq_restore(flags);
+}
+
+/**
+ * @brief Take a snapshot of the heap counters.
+ *
+ * @param stats Output structure.
+ */
+void kmalloc_get_stats(kmalloc_stats_t *stats)
+{
+    uint32_t flags = cpu_irq_save();
+
+    for (uint32_t i = 0; i < KMALLOC_CACHE_COUNT; i++)
+    {
+        const kmem_cache_t *cache = &caches[i];
+        kmalloc_cache_stats_t *out = &stats->caches[i];
+        uint32_t slab_bytes = PAGE_SIZE << cache->slab_order;
+
+        out->object_size = cache->object_size;
+        out->slab_pages = 1u << cache->slab_order;
+        out->objects_per_slab = cache->objects_per_slab;
+        out->objects_in_use = cache->objects_in_use;
+        out->slabs = cache->slabs;
+        out->overhead_bytes = cache->slabs *
+            (slab_bytes - cache->objects_per_slab * cache->object_size);
+    }
+
+    stats->large_objects = large_objects;
+    stats->large_pages = large_pages;
+    stats->bytes_requested = bytes_requested;
+    stats->bytes_allocated = bytes_allocated;
+
+    cpu_irq_restore(flags);
+}
+
+/**
+ * @brief Print per-cache heap usage.
+ */
+void kmalloc_print_stats(void)
+{
+    kmalloc_stats_t stats;
+    kmalloc_get_stats(&stats);
+
+    kprintf("kmalloc caches (size: in use/capacity, slabs, overhead):\n");
+    for (uint32_t i = 0; i < KMALLOC_CACHE_COUNT; i++)
+    {
+        const kmalloc_cache_stats_t *cache = &stats.caches[i];
+        kprintf("  %u: %u/%u, %u x %u KiB, %u B\n",
+                cache->object_size,
+                cache->objects_in_use,
+                cache->slabs * cache->objects_per_slab,
+                cache->slabs,
+                cache->slab_pages * (PAGE_SIZE / 1024),
+                cache->overhead_bytes);
+    }
+
+    // Scale both totals down until the divisor fits the 64-by-32 divide
+    uint64_t wasted = stats.bytes_allocated - stats.bytes_requested;
+    uint64_t allocated = stats.bytes_allocated;
+    while (allocated >> 32)
+    {
+        allocated >>= 1;
+        wasted >>= 1;
+    }
+    uint32_t rounding_pct = allocated ? (uint32_t)udivmod64(wasted * 100, (uint32_t)allocated, NULL) : 0;
+
+    kprintf("  large: %u objects, %u pages; size rounding wasted %u%% of allocated bytes\n",
+            stats.large_objects, stats.large_pages, rounding_pct);
+}
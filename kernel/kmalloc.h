@@ -0,0 +1,34 @@
+#ifndef KMALLOC_H_
+#define KMALLOC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define KMALLOC_MIN_SHIFT   4           // Smallest size class: 16 B
+#define KMALLOC_MAX_SHIFT   11          // Largest size class: 2 KiB
+#define KMALLOC_CACHE_COUNT (KMALLOC_MAX_SHIFT - KMALLOC_MIN_SHIFT + 1)
+
+typedef struct {
+    uint32_t object_size;
+    uint32_t slab_pages;                // Pages per slab
+    uint32_t objects_per_slab;
+    uint32_t objects_in_use;
+    uint32_t slabs;
+    uint32_t overhead_bytes;            // Slab headers and tail slack across all slabs
+} kmalloc_cache_stats_t;
+
+typedef struct {
+    kmalloc_cache_stats_t caches[KMALLOC_CACHE_COUNT];
+    uint32_t large_objects;             // Live allocations above 2 KiB
+    uint32_t large_pages;
+    uint64_t bytes_requested;           // Lifetime totals; their difference is the
+    uint64_t bytes_allocated;           // internal fragmentation from size rounding
+} kmalloc_stats_t;
+
+void kmalloc_init(void);
+void *kmalloc(size_t size);
+void kfree(void *ptr);
+void kmalloc_get_stats(kmalloc_stats_t *stats);
+void kmalloc_print_stats(void);
+
+#endif
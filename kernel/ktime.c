@@ -0,0 +1,224 @@
+/**
+ * ktime.c
+ *
+ * Monotonic Kernel Time
+ *
+ * Time is read from the TSC: one RDTSC, no port I/O and no locking, so
+ * ktime_get_ns() is cheap enough for any context, interrupt handlers
+ * included. The PIT is only used once, by ktime_init(), to find out
+ * how fast the TSC counts.
+ *
+ * Time 0 is the earliest boot stage timestamp (the boot sector entry,
+ * or kmain when booted via Multiboot), the same origin as the boot
+ * timeline and klog timestamps.
+ *
+ * --------------------------------------------------------------------
+ * CALIBRATION
+ * --------------------------------------------------------------------
+ *
+ * PIT channel 2 counts down KTIME_CALIBRATE_MS milliseconds while the
+ * TSC cycles are counted; the channel is polled, so no interrupt needs
+ * to be set up yet. An SMI or a slow port read can only make a run
+ * look longer, so the shortest of KTIME_CALIBRATE_RUNS runs is kept.
+ * The result is cached: ktime_tsc_khz() never touches the PIT.
+ *
+ * This assumes an invariant TSC, i.e. one that does not change rate
+ * with the CPU's clock; true of everything since about 2008 and of
+ * QEMU.
+ *
+ * --------------------------------------------------------------------
+ * CYCLES TO NANOSECONDS
+ * --------------------------------------------------------------------
+ *
+ * There is no 64-bit divide instruction on i386, so instead of
+ * dividing by the frequency every time, ktime_init() precomputes
+ *
+ *     mult = 10^6 * 2^KTIME_SHIFT / khz
+ *
+ * and a conversion is a multiply and a shift. With KTIME_SHIFT = 24,
+ * mult fits in 32 bits for any TSC faster than 4 MHz and is exact to
+ * better than one part per million for any TSC faster than 16 MHz.
+ *
+ */
+
+#include "ktime.h"
+#include "boot_info.h"
+#include "cpu.h"
+#include "math.h"
+#include "pit.h"
+#include "timer.h"
+
+#include <stddef.h>
+
+static uint32_t tsc_khz;
+static uint32_t ns_mult;                // ns = cycles * ns_mult >> KTIME_SHIFT
+static uint64_t tsc_base;               // TSC at time 0
+
+/**
+ * @brief Measure the TSC frequency once against PIT channel 2.
+ *
+ * @return TSC cycles per millisecond.
+ */
+static uint32_t calibrate_run(void)
+{
+    pit_oneshot_start(PIT_FREQUENCY / (1000 / KTIME_CALIBRATE_MS));
+
+    uint64_t start = cpu_rdtsc();
+    while (!pit_oneshot_expired())
+    {
+    }
+    uint64_t end = cpu_rdtsc();
+
+    return (uint32_t)udivmod64(end - start, KTIME_CALIBRATE_MS, NULL);
+}
+
+/**
+ * @brief Calibrate the TSC and set the time origin.
+ *
+ * Takes about KTIME_CALIBRATE_RUNS * KTIME_CALIBRATE_MS milliseconds.
+ * Call early: every other time function returns 0 or does nothing
+ * until this has run.
+ */
+void ktime_init(void)
+{
+    uint32_t khz = 0;
+
+    for (uint32_t run = 0; run < KTIME_CALIBRATE_RUNS; run++)
+    {
+        uint32_t flags = cpu_irq_save();
+        uint32_t measured = calibrate_run();
+        cpu_irq_restore(flags);
+
+        if (!khz || measured < khz)
+        {
+            khz = measured;
+        }
+    }
+
+    tsc_base = cpu_rdtsc();
+    for (boot_stage_t stage = BOOT_STAGE_ENTRY; stage < BOOT_STAGE_COUNT; stage++)
+    {
+        if (BOOT_INFO->tsc[stage])
+        {
+            tsc_base = BOOT_INFO->tsc[stage];
+            break;
+        }
+    }
+
+    ns_mult = (uint32_t)udivmod64((uint64_t)1000000 << KTIME_SHIFT, khz, NULL);
+    tsc_khz = khz;
+}
+
+/**
+ * @brief Get the calibrated TSC frequency.
+ *
+ * @return TSC frequency in kHz, 0 before ktime_init().
+ */
+uint32_t ktime_tsc_khz(void)
+{
+    return tsc_khz;
+}
+
+/**
+ * @brief Get the TSC cycles elapsed since time 0.
+ */
+uint64_t ktime_get_cycles(void)
+{
+    return cpu_rdtsc() - tsc_base;
+}
+
+/**
+ * @brief Convert a TSC cycle count to nanoseconds.
+ */
+uint64_t ktime_cycles_to_ns(uint64_t cycles)
+{
+    uint32_t low = (uint32_t)cycles;
+    uint32_t high = (uint32_t)(cycles >> 32);
+
+    // 64 x 32 bit multiply, split so neither half overflows
+    return (((uint64_t)low * ns_mult) >> KTIME_SHIFT) +
+           (((uint64_t)high * ns_mult) << (32 - KTIME_SHIFT));
+}
+
+/**
+ * @brief Convert nanoseconds to TSC cycles, rounding down.
+ */
+uint64_t ktime_ns_to_cycles(uint64_t ns)
+{
+    uint32_t ns_rem;
+    uint64_t us = udivmod64(ns, 1000, &ns_rem);
+
+    return udivmod64(us * tsc_khz, 1000, NULL) + udivmod64((uint64_t)ns_rem * tsc_khz, 1000000, NULL);
+}
+
+/**
+ * @brief Get the nanoseconds elapsed since time 0.
+ *
+ * Monotonic, one RDTSC; safe from any context.
+ */
+uint64_t ktime_get_ns(void)
+{
+    return ktime_cycles_to_ns(ktime_get_cycles());
+}
+
+/**
+ * @brief Busy-wait for at least @p us microseconds.
+ *
+ * Works with interrupts disabled; meant for short hardware delays.
+ * Use msleep() for anything in the millisecond range.
+ */
+void udelay(uint32_t us)
+{
+    uint64_t start = cpu_rdtsc();
+    uint64_t cycles = udivmod64((uint64_t)us * tsc_khz, 1000, NULL);
+
+    while (cpu_rdtsc() - start < cycles)
+    {
+        __asm__ volatile ("pause");
+    }
+}
+
+static void sleep_wake(void *ctx)
+{
+    (void)ctx;                          // The interrupt itself is the wakeup
+}
+
+/**
+ * @brief Wait for at least @p ms milliseconds.
+ *
+ * With interrupts enabled and the timer core running, a timer is armed
+ * for the deadline and the CPU halts until then; otherwise this spins
+ * like udelay().
+ */
+void msleep(uint32_t ms)
+{
+    uint64_t deadline = ktime_get_ns() + (uint64_t)ms * 1000000;
+    uint32_t flags = cpu_irq_save();
+    bool halt = (flags & EFLAGS_IF) && timers_active();
+    ktimer_t wake;
+
+    cpu_irq_restore(flags);
+    if (!halt)
+    {
+        while (ktime_get_ns() < deadline)
+        {
+            __asm__ volatile ("pause");
+        }
+        return;
+    }
+
+    timer_init(&wake, sleep_wake, NULL);
+    add_timer(&wake, deadline);
+    for (;;)
+    {
+        // Checked with interrupts off so the wakeup cannot slip in before hlt
+        __asm__ volatile ("cli" : : : "memory");
+        if (ktime_get_ns() >= deadline)
+        {
+            break;
+        }
+        __asm__ volatile ("sti; hlt" : : : "memory");
+    }
+    __asm__ volatile ("sti" : : : "memory");
+    del_timer(&wake);
+}
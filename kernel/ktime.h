@@ -0,0 +1,19 @@
+#ifndef KTIME_H_
+#define KTIME_H_
+
+#include <stdint.h>
+
+#define KTIME_CALIBRATE_MS 10           // Length of one calibration run
+#define KTIME_CALIBRATE_RUNS 3          // Runs; the shortest wins
+#define KTIME_SHIFT 24                  // Fixed-point shift of the cycles-to-ns factor
+
+void ktime_init(void);
+uint32_t ktime_tsc_khz(void);
+uint64_t ktime_get_cycles(void);
+uint64_t ktime_get_ns(void);
+uint64_t ktime_cycles_to_ns(uint64_t cycles);
+uint64_t ktime_ns_to_cycles(uint64_t ns);
+void udelay(uint32_t us);
+void msleep(uint32_t ms);
+
+#endif
@@ -3,22 +3,206 @@
 #include "idt.h"     // Add this
 #include "pic.h"
 #include "keyboard.h"
+#include "isr.h"
+#include "acpi.h"
+#include "apic.h"
+#include "irq_bench.h"
+#include "softirq.h"
+#include "ktime.h"
+#include "timer.h"
+#include "boot_info.h"
+#include "boot_timeline.h"
+#include "pmm.h"
+#include "vmm.h"
+#include "kmalloc.h"
+#include "boot_arena.h"
+#include "memops.h"
+#include "memory.h"
+#include "fpu.h"
+#include "console_bench.h"
+#include "framebuffer.h"
+#include "format_bench.h"
+#include "klog.h"
+#include "serial.h"
+#include "serial_bench.h"
 // ...
 
 
-void kmain()
+/**
+ * @brief Act on a key event from the idle loop.
+ *
+ * Characters are echoed, Page Up/Down browse the scrollback and F12
+ * prints the interrupt and timer statistics.
+ */
+static void console_key(const kbd_event_t *event)
 {
+    if (event->flags & KBD_RELEASED)
+    {
+        return;
+    }
+
+    switch (event->key)
+    {
+    case KEY_PAGE_UP:
+        screen_view_scroll(-(MAX_ROWS - 1));
+        break;
+    case KEY_PAGE_DOWN:
+        screen_view_scroll(MAX_ROWS - 1);
+        break;
+    case KEY_F12:
+        isr_print_stats();
+        timer_print_stats();
+        break;
+    default:
+        if (event->ascii)
+        {
+            screen_putc(event->ascii);
+        }
+        break;
+    }
+    screen_flush();
+}
+
+static work_t console_work;
+
+/**
+ * @brief Work item: handle every key typed since it last ran.
+ */
+static void console_input(void *ctx)
+{
+    kbd_event_t event;
+    (void)ctx;
+
+    while (kbd_read(&event, false))
+    {
+        console_key(&event);
+    }
+}
+
+/**
+ * @brief IRQ1 bottom half: leave the decoding and echo to the idle loop,
+ *        since the console must not be entered from interrupts.
+ */
+static void keyboard_bottom_half(void *ctx)
+{
+    (void)ctx;
+    work_queue(&console_work);
+}
+
+/**
+ * @brief Sleep until the next interrupt unless work is waiting.
+ *
+ * The check runs with interrupts off and `sti; hlt` cannot be split by
+ * an interrupt, so a wakeup raised in between is not missed.
+ */
+static void idle_wait(void)
+{
+    __asm__ volatile ("cli" : : : "memory");
+    if (!klog_pending() && !softirq_pending() && !work_pending())
+    {
+        __asm__ volatile ("sti; hlt" : : : "memory");
+    }
+    else
+    {
+        __asm__ volatile ("sti" : : : "memory");
+    }
+}
+
+void kmain(uint32_t boot_magic, uint32_t boot_data)
+{
+    boot_info_init(boot_magic, boot_data);
+    boot_timeline_mark(BOOT_STAGE_KMAIN);
+    ktime_init();
+    fpu_init();
+    memops_init();
+    framebuffer_init();
+    softirq_init();
+    serial_init();
+
     screen_clear();
     screen_set_cursor(0);
 
     int version = 1;
     int revision = 0;
     kprintf("Hello Welcome to LiburnOS revision %d.%d\n", version, revision);
+    kprintf("SSE %s, memory ops: %s\n", fpu_sse_enabled() ? "enabled" : "unavailable",
+            memory_selected_name());
+    if (serial_active())
+    {
+        kprintf("Serial console on COM1, %u baud\n", SERIAL_BAUD);
+    }
+    if (BOOT_INFO->source == BOOT_SOURCE_MULTIBOOT)
+    {
+        kprintf("Booted via Multiboot, command line: \"%s\"\n", BOOT_INFO->cmdline);
+    }
+
+    pmm_init();
+    boot_timeline_mark(BOOT_STAGE_MEMORY);
+    boot_arena_init();
+    boot_params_parse();
+    if (boot_param("membench"))
+    {
+        memops_benchmark();
+    }
+    if (boot_param("consbench"))
+    {
+        console_benchmark();
+    }
+    if (boot_param("fmtbench"))
+    {
+        format_benchmark();
+    }
+    pmm_print_stats();
+    acpi_init();
+    framebuffer_map();
+    vmm_init();
+    boot_timeline_mark(BOOT_STAGE_PAGING);
+    kmalloc_init();
 
     pic_remap(0x20, 0x28);
+    boot_timeline_mark(BOOT_STAGE_PIC);
     kprintf("PIC remapped.\n");
     idt_init();
+    boot_timeline_mark(BOOT_STAGE_IDT);
     kprintf("IDT Initialized. Interrupts enabled.\n");
+    if (!boot_param("nolapic") && apic_init())
+    {
+        kprintf("IRQs routed through the I/O APIC (local APIC %u).\n", apic_lapic_id());
+    }
+    else
+    {
+        kprintf("IRQs routed through the 8259 PIC.\n");
+    }
+    timers_init();
+    kprintf("Tickless timers on the PIT, TSC %u kHz.\n", ktime_tsc_khz());
     keyboard_init();
-    for (;;){}
+    work_init(&console_work, console_input, NULL);
+    softirq_register(SOFTIRQ_IRQ(KEYBOARD_IRQ), keyboard_bottom_half, NULL);
+    irq_register(KEYBOARD_IRQ, keyboard_handler, NULL);
+    boot_timeline_mark(BOOT_STAGE_KEYBOARD);
+    irq_register(SERIAL_COM1_IRQ, serial_handler, NULL);
+    serial_enable_irq();
+    if (boot_param("serbench"))
+    {
+        serial_benchmark();
+    }
+
+    if (boot_param("irqbench"))
+    {
+        irq_benchmark();
+    }
+    boot_timeline_report();
+    if (boot_param("irqstats"))
+    {
+        isr_print_stats();
+    }
+    boot_arena_release();
+    screen_flush();
+    for (;;)
+    {
+        klog_drain();
+        softirq_run();
+        workqueue_run();
+        idle_wait();
+    }
 }
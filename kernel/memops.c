@@ -0,0 +1,147 @@
+/**
+ * memops.c
+ *
+ * Memory Operation Selection
+ *
+ * lib/memory.c provides several implementations of memcpy & co. (see
+ * memory.h); this file picks one for the running CPU and can benchmark
+ * all of them.
+ *
+ * --------------------------------------------------------------------
+ * SELECTION
+ * --------------------------------------------------------------------
+ *
+ * SSE2 is used when CPUID reports it and fpu_init() enabled SSE,
+ * unless the CPU also reports ERMS (enhanced REP MOVSB/STOSB). With
+ * ERMS, microcode moves whole cache lines per step and `rep movs/stos`
+ * beat the 16-byte loop for copies and fills, which is what the kernel
+ * mostly does; only memcmp would be faster with SSE2. Everything else
+ * gets the REP string variant, which every i386 supports.
+ *
+ * --------------------------------------------------------------------
+ * BENCHMARK
+ * --------------------------------------------------------------------
+ *
+ * Booting with the `membench` parameter prints the average cycles per
+ * call of every usable variant. Sizes follow the console's software
+ * scroll (a 24-row overlapping memmove and a one-row memset16), plus
+ * 4 KiB memcpy/memset/memcmp (memcmp on equal buffers, so it scans
+ * everything). Buffers come from the boot arena.
+ *
+ */
+
+#include "memops.h"
+#include "memory.h"
+#include "cpu.h"
+#include "kprintf.h"
+#include "boot_arena.h"
+#include "fpu.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BENCH_BYTES         4096
+#define BENCH_ROW_BYTES     160         // One 80-column text row
+#define BENCH_SCREEN_CELLS  (80 * 25)
+#define BENCH_SHIFT         5           // 2^5 = 32 timed calls per measurement
+
+/**
+ * @brief Check whether the SSE2 variant can run.
+ */
+static bool memops_sse2_usable(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+    cpu_cpuid(0, &eax, &ebx, &ecx, &edx);
+    if (eax < 1)
+    {
+        return false;
+    }
+
+    cpu_cpuid(1, &eax, &ebx, &ecx, &edx);
+    return (edx & CPUID_EDX_SSE2) && fpu_sse_enabled();
+}
+
+/**
+ * @brief Check for enhanced (fast) REP MOVSB/STOSB.
+ */
+static bool memops_has_erms(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+    cpu_cpuid(0, &eax, &ebx, &ecx, &edx);
+    if (eax < 7)
+    {
+        return false;
+    }
+
+    cpu_cpuid(7, &eax, &ebx, &ecx, &edx);
+    return ebx & CPUID_7_EBX_ERMS;
+}
+
+/**
+ * @brief Select the fastest memory implementation for this CPU.
+ *
+ * Runs early in kmain(), after fpu_init(); memcpy & co. use the REP
+ * variant until then.
+ */
+void memops_init(void)
+{
+    bool sse2 = memops_sse2_usable() && !memops_has_erms();
+    memory_select(sse2 ? MEMORY_IMPL_SSE2 : MEMORY_IMPL_REP);
+}
+
+/**
+ * @brief Print cycles per call for each memory implementation.
+ */
+void memops_benchmark(void)
+{
+    arena_mark_t mark = arena_mark(&boot_arena);
+    uint8_t *src = arena_alloc_aligned(&boot_arena, BENCH_BYTES, 16);
+    uint8_t *dst = arena_alloc_aligned(&boot_arena, BENCH_BYTES, 16);
+    if (!src || !dst)
+    {
+        kprintf("membench: no scratch memory\n");
+        arena_release(&boot_arena, mark);
+        return;
+    }
+
+    memory_impl_t last = memops_sse2_usable() ? MEMORY_IMPL_SSE2 : MEMORY_IMPL_REP;
+
+    kprintf("membench: cycles/call, selected %s (cpy/set/cmp 4K, scroll-sized mov/set16)\n",
+            memory_selected_name());
+
+    for (memory_impl_t impl = MEMORY_IMPL_BYTE; impl <= last; impl++)
+    {
+        const memory_ops_t *ops = memory_get_ops(impl);
+        uint32_t cycles[5];
+
+        ops->memset(src, 0x5A, BENCH_BYTES);
+        ops->memcpy(dst, src, BENCH_BYTES);       // Warm caches and TLB
+
+        for (int op = 0; op < 5; op++)
+        {
+            uint64_t start = cpu_rdtsc();
+            for (int i = 0; i < (1 << BENCH_SHIFT); i++)
+            {
+                switch (op)
+                {
+                case 0: ops->memcpy(dst, src, BENCH_BYTES); break;
+                case 1: ops->memmove(dst, dst + BENCH_ROW_BYTES, BENCH_SCREEN_CELLS * 2 - BENCH_ROW_BYTES); break;
+                case 2: ops->memset(dst, 0x5A, BENCH_BYTES); break;
+                case 3: ops->memset16(dst, 0x0720, BENCH_ROW_BYTES / 2); break;
+                case 4: ops->memcmp(dst, src, BENCH_BYTES); break;
+                }
+            }
+            cycles[op] = (uint32_t)((cpu_rdtsc() - start) >> BENCH_SHIFT);
+
+            if (op == 3)
+            {
+                ops->memset(dst, 0x5A, BENCH_BYTES);  // memcmp compares equal buffers
+            }
+        }
+
+        kprintf("  %s  cpy %u  mov %u  set %u  set16 %u  cmp %u\n", ops->name,
+                cycles[0], cycles[1], cycles[2], cycles[3], cycles[4]);
+    }
+
+    arena_release(&boot_arena, mark);
+}
@@ -0,0 +1,7 @@
+#ifndef MEMOPS_H_
+#define MEMOPS_H_
+
+void memops_init(void);
+void memops_benchmark(void);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef MULTIBOOT_H_
+#define MULTIBOOT_H_
+
+#include <stdint.h>
+
+// Multiboot specification version 0.6.96 (Multiboot 1)
+#define MULTIBOOT_BOOTLOADER_MAGIC  0x2BADB002  // Passed in EAX by a compliant loader
+
+// multiboot_info_t.flags
+#define MULTIBOOT_INFO_MEMORY       0x00000001  // mem_lower/mem_upper valid
+#define MULTIBOOT_INFO_CMDLINE      0x00000004  // cmdline valid
+#define MULTIBOOT_INFO_MEM_MAP      0x00000040  // mmap_length/mmap_addr valid
+
+typedef struct {
+    uint32_t flags;
+    uint32_t mem_lower;         // KiB of memory below 1 MiB
+    uint32_t mem_upper;         // KiB of memory above 1 MiB (up to the first hole)
+    uint32_t boot_device;
+    uint32_t cmdline;           // Physical address of a NUL-terminated string
+    uint32_t mods_count;
+    uint32_t mods_addr;
+    uint32_t syms[4];
+    uint32_t mmap_length;       // Size of the memory map buffer in bytes
+    uint32_t mmap_addr;         // Physical address of the first multiboot_mmap_entry_t
+} __attribute__((packed)) multiboot_info_t;
+
+typedef struct {
+    uint32_t size;              // Size of the entry, not counting this field
+    uint64_t addr;
+    uint64_t len;
+    uint32_t type;              // Same encoding as BIOS E820 types
+} __attribute__((packed)) multiboot_mmap_entry_t;
+
+#endif
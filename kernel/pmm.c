@@ -0,0 +1,525 @@
+/**
+ * pmm.c
+ *
+ * Physical Memory Manager
+ *
+ * Hands out physical page frames from the RAM described by the boot
+ * memory map (BIOS E820 or Multiboot, see boot_info.c).
+ *
+ * --------------------------------------------------------------------
+ * BOOKKEEPING
+ * --------------------------------------------------------------------
+ *
+ * A bitmap holds one bit per 4 KiB frame up to the highest usable
+ * address:
+ *     0 : frame is free
+ *     1 : frame is allocated, reserved or not RAM at all
+ *
+ * The bitmap itself is placed in the first usable RAM above 1 MiB
+ * that is large enough, and its frames are reserved.
+ *
+ * --------------------------------------------------------------------
+ * BUDDY FREE LISTS
+ * --------------------------------------------------------------------
+ *
+ * Free memory is kept as naturally aligned blocks of 2^order frames,
+ * order 0..PMM_MAX_ORDER, with one doubly linked list per order. The
+ * list node lives in the first bytes of the free block itself, so no
+ * extra memory is needed.
+ *
+ * Allocating takes a block from the smallest non-empty list that is
+ * large enough and splits it in halves, returning the unused halves to
+ * the lower lists. Freeing merges a block with its buddy
+ * (frame ^ (1 << order)) for as long as the buddy is a free block of
+ * the same order. The buddy test is O(1): its first frame must be free
+ * in the bitmap and its list node must record the same order. Both
+ * operations therefore touch at most PMM_MAX_ORDER lists, O(log n).
+ *
+ * --------------------------------------------------------------------
+ * RESERVED MEMORY
+ * --------------------------------------------------------------------
+ *
+ *     0x00000 - 0x00FFF : IVT, BIOS data area, BOOT_INFO
+ *     0x10000 - end     : Kernel image (.text to .bss)
+ *     0x80000 - 0x8FFFF : Kernel stack (grows down from 0x90000)
+ *     0xA0000 - 0xFFFFF : VGA memory and BIOS ROMs
+ *
+ * These are reserved even if the memory map reports them as usable.
+ *
+ */
+
+#include "pmm.h"
+#include "boot_info.h"
+#include "kprintf.h"
+#include "memory.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define LOW_MEMORY_END      0x1000
+#define KERNEL_STACK_BOTTOM 0x80000
+#define KERNEL_STACK_TOP    0x90000
+#define VGA_HOLE_START      0xA0000
+#define VGA_HOLE_END        0x100000
+#define BITMAP_MIN_ADDRESS  0x100000
+#define ADDRESS_LIMIT       0x100000000ULL  // Frames above 4 GiB are not addressable
+
+extern char __kernel_start[];
+extern char __kernel_end[];
+
+typedef struct pmm_block {
+    struct pmm_block *next;
+    struct pmm_block *prev;
+    uint32_t order;
+} pmm_block_t;
+
+static uint32_t *frame_bitmap;
+static uint32_t frame_count;
+
+static pmm_block_t *free_lists[PMM_MAX_ORDER + 1];
+static uint32_t free_blocks[PMM_MAX_ORDER + 1];
+
+static uint32_t total_pages;
+static uint32_t reserved_pages;
+static uint32_t free_pages;
+
+static inline bool frame_used(uint32_t frame)
+{
+    return frame_bitmap[frame >> 5] & (1u << (frame & 31));
+}
+
+/**
+ * @brief Mark a run of frames as used or free in the bitmap.
+ *
+ * Whole 32-frame words are written at once; only the unaligned head
+ * and tail are updated bit by bit.
+ *
+ * @param first First frame of the run.
+ * @param count Number of frames.
+ * @param used  true to mark used, false to mark free.
+ */
+static void bitmap_set_range(uint32_t first, uint32_t count, bool used)
+{
+    while (count && (first & 31))
+    {
+        if (used)
+            frame_bitmap[first >> 5] |= 1u << (first & 31);
+        else
+            frame_bitmap[first >> 5] &= ~(1u << (first & 31));
+        first++;
+        count--;
+    }
+
+    while (count >= 32)
+    {
+        frame_bitmap[first >> 5] = used ? 0xFFFFFFFF : 0;
+        first += 32;
+        count -= 32;
+    }
+
+    while (count)
+    {
+        if (used)
+            frame_bitmap[first >> 5] |= 1u << (first & 31);
+        else
+            frame_bitmap[first >> 5] &= ~(1u << (first & 31));
+        first++;
+        count--;
+    }
+}
+
+/**
+ * @brief Check that every frame in a run is free.
+ *
+ * @param first First frame of the run.
+ * @param count Number of frames.
+ *
+ * @return true if none of the frames is marked used.
+ */
+static bool bitmap_range_free(uint32_t first, uint32_t count)
+{
+    while (count && (first & 31))
+    {
+        if (frame_used(first))
+            return false;
+        first++;
+        count--;
+    }
+
+    while (count >= 32)
+    {
+        if (frame_bitmap[first >> 5])
+            return false;
+        first += 32;
+        count -= 32;
+    }
+
+    while (count)
+    {
+        if (frame_used(first))
+            return false;
+        first++;
+        count--;
+    }
+
+    return true;
+}
+
+static void free_list_push(uint32_t frame, uint32_t order)
+{
+    pmm_block_t *block = (pmm_block_t *)(frame << PAGE_SHIFT);
+
+    block->order = order;
+    block->prev = NULL;
+    block->next = free_lists[order];
+    if (block->next)
+    {
+        block->next->prev = block;
+    }
+    free_lists[order] = block;
+    free_blocks[order]++;
+}
+
+static void free_list_remove(pmm_block_t *block)
+{
+    if (block->prev)
+    {
+        block->prev->next = block->next;
+    }
+    else
+    {
+        free_lists[block->order] = block->next;
+    }
+
+    if (block->next)
+    {
+        block->next->prev = block->prev;
+    }
+    free_blocks[block->order]--;
+}
+
+/**
+ * @brief Withhold an address range from the allocator.
+ *
+ * Frames touched by the range are marked used. Only frames that were
+ * usable RAM are counted as reserved.
+ *
+ * @param start First byte of the range.
+ * @param end   One past the last byte of the range.
+ */
+static void pmm_reserve(uint32_t start, uint32_t end)
+{
+    uint32_t first = start >> PAGE_SHIFT;
+    uint32_t last = (end + PAGE_SIZE - 1) >> PAGE_SHIFT;
+
+    for (uint32_t frame = first; frame < last && frame < frame_count; frame++)
+    {
+        if (!frame_used(frame))
+        {
+            frame_bitmap[frame >> 5] |= 1u << (frame & 31);
+            reserved_pages++;
+        }
+    }
+}
+
+/**
+ * @brief Find a home for the frame bitmap.
+ *
+ * @param bytes Size of the bitmap.
+ *
+ * @return Page-aligned physical address in usable RAM above 1 MiB, or
+ *         0 if no region is large enough.
+ */
+static uint32_t pmm_place_bitmap(uint32_t bytes)
+{
+    for (uint32_t i = 0; i < BOOT_INFO->mmap_count; i++)
+    {
+        const boot_mmap_entry_t *entry = &BOOT_INFO->mmap[i];
+        if (entry->type != BOOT_MMAP_AVAILABLE)
+        {
+            continue;
+        }
+
+        uint64_t start = entry->base < BITMAP_MIN_ADDRESS ? BITMAP_MIN_ADDRESS : entry->base;
+        uint64_t end = entry->base + entry->length;
+        start = (start + PAGE_SIZE - 1) & ~(uint64_t)(PAGE_SIZE - 1);
+
+        if (start + bytes <= end && start + bytes <= ADDRESS_LIMIT)
+        {
+            return (uint32_t)start;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Initialize the physical memory manager from BOOT_INFO.
+ *
+ * Sizes and places the frame bitmap, marks the usable regions of the
+ * memory map free, reserves the kernel, stack, low memory and VGA/BIOS
+ * hole, then carves the remaining free frames into the largest aligned
+ * buddy blocks possible.
+ */
+void pmm_init(void)
+{
+    uint64_t highest = 0;
+
+    for (uint32_t i = 0; i < BOOT_INFO->mmap_count; i++)
+    {
+        const boot_mmap_entry_t *entry = &BOOT_INFO->mmap[i];
+        uint64_t end = entry->base + entry->length;
+
+        if (entry->type == BOOT_MMAP_AVAILABLE && entry->base < ADDRESS_LIMIT && end > highest)
+        {
+            highest = end > ADDRESS_LIMIT ? ADDRESS_LIMIT : end;
+        }
+    }
+
+    if (highest == 0)
+    {
+        kprintf("pmm: no memory map from the boot loader, allocator disabled\n");
+        return;
+    }
+
+    frame_count = (uint32_t)(highest >> PAGE_SHIFT);
+    uint32_t bitmap_bytes = ((frame_count + 31) / 32) * sizeof(uint32_t);
+
+    frame_bitmap = (uint32_t *)pmm_place_bitmap(bitmap_bytes);
+    if (!frame_bitmap)
+    {
+        kprintf("pmm: no room for a %u byte frame bitmap, allocator disabled\n", bitmap_bytes);
+        frame_count = 0;
+        return;
+    }
+
+    // Everything starts out unusable; punch in the RAM the map reports
+    memset(frame_bitmap, 0xFF, bitmap_bytes);
+    for (uint32_t i = 0; i < BOOT_INFO->mmap_count; i++)
+    {
+        const boot_mmap_entry_t *entry = &BOOT_INFO->mmap[i];
+        if (entry->type != BOOT_MMAP_AVAILABLE || entry->base >= highest)
+        {
+            continue;
+        }
+
+        uint64_t end = entry->base + entry->length;
+        if (end > highest)
+        {
+            end = highest;
+        }
+
+        // Only whole frames inside the region are usable
+        uint32_t first = (uint32_t)((entry->base + PAGE_SIZE - 1) >> PAGE_SHIFT);
+        uint32_t last = (uint32_t)(end >> PAGE_SHIFT);
+        if (last > first)
+        {
+            bitmap_set_range(first, last - first, false);
+        }
+    }
+
+    pmm_reserve(0, LOW_MEMORY_END);
+    pmm_reserve((uint32_t)__kernel_start, (uint32_t)__kernel_end);
+    pmm_reserve(KERNEL_STACK_BOTTOM, KERNEL_STACK_TOP);
+    pmm_reserve(VGA_HOLE_START, VGA_HOLE_END);
+    pmm_reserve((uint32_t)frame_bitmap, (uint32_t)frame_bitmap + bitmap_bytes);
+
+    // Carve free frames into maximal naturally aligned blocks
+    uint32_t frame = 0;
+    while (frame < frame_count)
+    {
+        if (frame_used(frame))
+        {
+            frame++;
+            continue;
+        }
+
+        uint32_t order = 0;
+        while (order < PMM_MAX_ORDER)
+        {
+            uint32_t size = 1u << (order + 1);
+            if ((frame & (size - 1)) || frame + size > frame_count ||
+                !bitmap_range_free(frame + (1u << order), 1u << order))
+            {
+                break;
+            }
+            order++;
+        }
+
+        free_list_push(frame, order);
+        free_pages += 1u << order;
+        frame += 1u << order;
+    }
+
+    total_pages = free_pages + reserved_pages;
+}
+
+/**
+ * @brief Allocate 2^order physically contiguous, naturally aligned pages.
+ *
+ * @param order Block size as a power of two in pages (0..PMM_MAX_ORDER).
+ *
+ * @return Physical address of the block, or 0 if no block is available.
+ *         (Frame 0 is always reserved, so 0 is never a valid block.)
+ */
+uint32_t pmm_alloc_pages(uint32_t order)
+{
+    if (order > PMM_MAX_ORDER)
+    {
+        return 0;
+    }
+
+    uint32_t current = order;
+    while (current <= PMM_MAX_ORDER && !free_lists[current])
+    {
+        current++;
+    }
+    if (current > PMM_MAX_ORDER)
+    {
+        return 0;
+    }
+
+    pmm_block_t *block = free_lists[current];
+    free_list_remove(block);
+    uint32_t frame = (uint32_t)block >> PAGE_SHIFT;
+
+    // Split, handing the upper halves back to the smaller lists
+    while (current > order)
+    {
+        current--;
+        free_list_push(frame + (1u << current), current);
+    }
+
+    bitmap_set_range(frame, 1u << order, true);
+    free_pages -= 1u << order;
+
+    return frame << PAGE_SHIFT;
+}
+
+/**
+ * @brief Return a block obtained from pmm_alloc_pages().
+ *
+ * Merges the block with its buddy as long as the buddy is free and of
+ * the same order. Invalid or double frees are reported and ignored.
+ *
+ * @param addr  Physical address returned by pmm_alloc_pages().
+ * @param order The order that was passed to pmm_alloc_pages().
+ */
+void pmm_free_pages(uint32_t addr, uint32_t order)
+{
+    uint32_t frame = addr >> PAGE_SHIFT;
+
+    if (order > PMM_MAX_ORDER || (addr & (PAGE_SIZE - 1)) ||
+        (frame & ((1u << order) - 1)) || frame + (1u << order) > frame_count)
+    {
+        kprintf("pmm: invalid free of 0x%x (order %u)\n", addr, order);
+        return;
+    }
+    if (!frame_used(frame))
+    {
+        kprintf("pmm: double free of 0x%x\n", addr);
+        return;
+    }
+
+    bitmap_set_range(frame, 1u << order, false);
+    free_pages += 1u << order;
+
+    while (order < PMM_MAX_ORDER)
+    {
+        uint32_t buddy = frame ^ (1u << order);
+        if (buddy + (1u << order) > frame_count || frame_used(buddy))
+        {
+            break;
+        }
+
+        pmm_block_t *block = (pmm_block_t *)(buddy << PAGE_SHIFT);
+        if (block->order != order)
+        {
+            break;
+        }
+
+        free_list_remove(block);
+        frame &= ~(1u << order);
+        order++;
+    }
+
+    free_list_push(frame, order);
+}
+
+/**
+ * @brief Allocate a single 4 KiB page.
+ *
+ * @return Physical address of the page, or 0 if memory is exhausted.
+ */
+uint32_t pmm_alloc_page(void)
+{
+    return pmm_alloc_pages(0);
+}
+
+/**
+ * @brief Free a single page obtained from pmm_alloc_page().
+ *
+ * @param addr Physical address of the page.
+ */
+void pmm_free_page(uint32_t addr)
+{
+    pmm_free_pages(addr, 0);
+}
+
+/**
+ * @brief Get the end of the physical memory the allocator manages.
+ *
+ * Every address the allocator can return lies below this value.
+ *
+ * @return One past the highest usable physical address (page aligned).
+ */
+uint32_t pmm_memory_end(void)
+{
+    // 2^20 frames would wrap to 0; clamp to the last page instead
+    return frame_count >= (1u << (32 - PAGE_SHIFT)) ? 0xFFFFF000 : frame_count << PAGE_SHIFT;
+}
+
+/**
+ * @brief Take a snapshot of the allocator counters.
+ *
+ * @param stats Output structure.
+ */
+void pmm_get_stats(pmm_stats_t *stats)
+{
+    stats->total_pages = total_pages;
+    stats->reserved_pages = reserved_pages;
+    stats->free_pages = free_pages;
+    stats->largest_free_order = 0;
+
+    for (uint32_t order = 0; order <= PMM_MAX_ORDER; order++)
+    {
+        stats->free_blocks[order] = free_blocks[order];
+        if (free_blocks[order])
+        {
+            stats->largest_free_order = order;
+        }
+    }
+}
+
+/**
+ * @brief Print total, free and fragmented physical memory.
+ *
+ * "Fragmented" is the free memory that cannot be handed out as a
+ * maximum-order (4 MiB) block.
+ */
+void pmm_print_stats(void)
+{
+    pmm_stats_t stats;
+    pmm_get_stats(&stats);
+
+    uint32_t unfragmented = stats.free_blocks[PMM_MAX_ORDER] << PMM_MAX_ORDER;
+
+    kprintf("Memory: %u KiB usable, %u KiB free, %u KiB reserved\n",
+            stats.total_pages * (PAGE_SIZE / 1024),
+            stats.free_pages * (PAGE_SIZE / 1024),
+            stats.reserved_pages * (PAGE_SIZE / 1024));
+    kprintf("Fragmented: %u KiB free outside %u KiB blocks, largest free block %u KiB\n",
+            (stats.free_pages - unfragmented) * (PAGE_SIZE / 1024),
+            (PAGE_SIZE / 1024) << PMM_MAX_ORDER,
+            stats.free_pages ? (PAGE_SIZE / 1024) << stats.largest_free_order : 0);
+}
@@ -0,0 +1,27 @@
+#ifndef PMM_H_
+#define PMM_H_
+
+#include <stdint.h>
+
+#define PAGE_SIZE       4096
+#define PAGE_SHIFT      12
+#define PMM_MAX_ORDER   10              // Largest block: 2^10 pages = 4 MiB
+
+typedef struct {
+    uint32_t total_pages;               // Usable RAM reported by the memory map
+    uint32_t reserved_pages;            // Usable RAM withheld (kernel, stack, bitmap, low memory)
+    uint32_t free_pages;
+    uint32_t free_blocks[PMM_MAX_ORDER + 1];
+    uint32_t largest_free_order;        // Order of the largest free block, valid if free_pages > 0
+} pmm_stats_t;
+
+void pmm_init(void);
+uint32_t pmm_alloc_pages(uint32_t order);
+void pmm_free_pages(uint32_t addr, uint32_t order);
+uint32_t pmm_alloc_page(void);
+void pmm_free_page(uint32_t addr);
+uint32_t pmm_memory_end(void);
+void pmm_get_stats(pmm_stats_t *stats);
+void pmm_print_stats(void);
+
+#endif
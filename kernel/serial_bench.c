@@ -0,0 +1,125 @@
+/**
+ * serial_bench.c
+ *
+ * Serial Output Benchmark
+ *
+ * Booting with the `serbench` parameter (e.g. make run
+ * CMDLINE="serbench", which runs QEMU with -serial stdio) sends
+ * BENCH_LINES lines of BENCH_LINE_CHARS characters to COM1 two ways:
+ *
+ *     polled - serial_write_polled(): an LSR poll before every byte
+ *     irq    - serial_write(): queued, then sent in FIFO bursts from
+ *              the THR-empty interrupt
+ *
+ * and reports per line the cycles the caller spent in the write call,
+ * the line status reads and THR-empty interrupts taken, and the
+ * throughput in bytes per second from the first write until the UART
+ * has sent the last byte. The lines appear on the serial console only.
+ *
+ */
+
+#include "serial_bench.h"
+#include "ktime.h"
+#include "cpu.h"
+#include "kprintf.h"
+#include "serial.h"
+#include "math.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BENCH_LINES         32
+#define BENCH_LINE_CHARS    60
+#define BENCH_LINE_BYTES    (BENCH_LINE_CHARS + 1)  // Including the newline
+
+typedef enum {
+    BENCH_POLLED = 0,
+    BENCH_IRQ,
+    BENCH_COUNT
+} bench_path_t;
+
+static const char *bench_names[BENCH_COUNT] = { "polled", "irq" };
+
+typedef struct {
+    uint32_t call_cycles;               // Spent inside the write call
+    uint64_t total_cycles;              // Until the last byte left the UART
+    uint32_t bytes;                     // Sent on the wire, CR included
+    uint32_t lsr_reads;
+    uint32_t tx_irqs;
+} bench_result_t;
+
+/**
+ * @brief Send the benchmark lines through one path and measure it.
+ */
+static void bench_run(bench_path_t path, const char *line, bench_result_t *result)
+{
+    serial_stats_t before, after;
+    uint64_t in_call = 0;
+
+    serial_flush();
+    serial_get_stats(&before);
+
+    uint64_t start = cpu_rdtsc();
+    for (int i = 0; i < BENCH_LINES; i++)
+    {
+        uint64_t call = cpu_rdtsc();
+        if (path == BENCH_POLLED)
+        {
+            serial_write_polled(line, BENCH_LINE_BYTES);
+        }
+        else
+        {
+            serial_write(line, BENCH_LINE_BYTES);
+        }
+        in_call += cpu_rdtsc() - call;
+    }
+    serial_flush();
+    uint64_t total = cpu_rdtsc() - start;
+
+    serial_get_stats(&after);
+    result->call_cycles = (uint32_t)udivmod64(in_call, BENCH_LINES, NULL);
+    result->total_cycles = total;
+    result->bytes = after.tx_bytes - before.tx_bytes;
+    result->lsr_reads = (after.lsr_reads - before.lsr_reads) / BENCH_LINES;
+    result->tx_irqs = (after.tx_irqs - before.tx_irqs) / BENCH_LINES;
+}
+
+/**
+ * @brief Compare polled and interrupt-driven serial output.
+ */
+void serial_benchmark(void)
+{
+    char line[BENCH_LINE_BYTES + 1];
+    bench_result_t results[BENCH_COUNT];
+    uint32_t khz = ktime_tsc_khz();
+
+    if (!serial_active())
+    {
+        kprintf("serbench: no UART at COM1\n");
+        return;
+    }
+
+    for (size_t i = 0; i < BENCH_LINE_CHARS; i++)
+    {
+        line[i] = 'a' + i % 26;
+    }
+    line[BENCH_LINE_CHARS] = '\n';
+    line[BENCH_LINE_CHARS + 1] = '\0';
+
+    for (bench_path_t path = BENCH_POLLED; path < BENCH_COUNT; path++)
+    {
+        bench_run(path, line, &results[path]);
+    }
+
+    kprintf("serbench: %u-char lines to COM1, per line:\n", BENCH_LINE_CHARS);
+    for (bench_path_t path = BENCH_POLLED; path < BENCH_COUNT; path++)
+    {
+        bench_result_t *r = &results[path];
+        uint32_t bytes_per_sec = r->total_cycles
+            ? (uint32_t)udivmod64((uint64_t)r->bytes * khz * 1000, r->total_cycles, NULL)
+            : 0;
+
+        kprintf("  %-6s: %u cycles in call, %u LSR reads, %u TX irqs, %u bytes/sec\n",
+                bench_names[path], r->call_cycles, r->lsr_reads, r->tx_irqs, bytes_per_sec);
+    }
+}
@@ -0,0 +1,6 @@
+#ifndef SERIAL_BENCH_H_
+#define SERIAL_BENCH_H_
+
+void serial_benchmark(void);
+
+#endif
@@ -0,0 +1,274 @@
+/**
+ * softirq.c
+ *
+ * Deferred Work: Softirqs and the Work Queue
+ *
+ * Interrupt handlers are split into a top half, which runs with
+ * interrupts disabled and does only what cannot wait (read the device,
+ * acknowledge it), and a bottom half that runs later with interrupts
+ * enabled. Two kinds of bottom half exist:
+ *
+ *     softirq     a handler per bit of a 32-bit pending bitmap; bits
+ *                 0-15 belong to the IRQ lines and are raised by
+ *                 irq_dispatch() whenever a top half claims its
+ *                 interrupt, bit 16 (SOFTIRQ_TIMER) runs expired
+ *                 timers. softirq_run() runs on the way out of every
+ *                 IRQ, after the EOI, with interrupts re-enabled, and
+ *                 again from the idle loop.
+ *     work item   a work_t queued with work_queue() from any context
+ *                 and run in FIFO order by workqueue_run() from the
+ *                 kmain idle loop, for anything longer (or anything
+ *                 that must not interrupt the console, which is not
+ *                 re-entrant).
+ *
+ * --------------------------------------------------------------------
+ * BUDGETS
+ * --------------------------------------------------------------------
+ *
+ * One softirq_run() makes at most SOFTIRQ_RESTARTS passes, each taking
+ * the whole pending bitmap at once so every raised softirq runs once
+ * per pass whatever the others do, and stops early after
+ * SOFTIRQ_BUDGET_US. Anything still pending waits for the next IRQ
+ * exit or the idle loop. workqueue_run() likewise stops after
+ * WORK_BUDGET_US; an item that requeues itself goes to the back.
+ *
+ * Budgets are converted to TSC cycles by softirq_init(); before that
+ * only the pass limit applies.
+ *
+ * Softirqs never nest: an IRQ taken while they run finds `running`
+ * set and leaves its bits for the pass in progress.
+ *
+ */
+
+#include "softirq.h"
+#include "cpu.h"
+#include "fpu.h"
+#include "ktime.h"
+
+#include <stddef.h>
+
+typedef struct {
+    softirq_handler_t handler;
+    void *ctx;
+} softirq_action_t;
+
+static softirq_action_t actions[SOFTIRQ_MAX];
+static uint32_t registered;             // Bit n: softirq n has a handler
+static uint32_t pending;                // Bit n: softirq n raised
+static bool running;                    // softirq_run() in progress
+
+static work_t *work_head;
+static work_t *work_tail;
+
+static uint32_t softirq_budget;         // Cycles; 0 until softirq_init()
+static uint32_t work_budget;
+
+static softirq_stats_t stats;
+
+/**
+ * @brief Convert the time budgets to TSC cycles.
+ */
+void softirq_init(void)
+{
+    uint32_t mhz = ktime_tsc_khz() / 1000;
+
+    softirq_budget = mhz * SOFTIRQ_BUDGET_US;
+    work_budget = mhz * WORK_BUDGET_US;
+}
+
+/**
+ * @brief Install the handler of a softirq.
+ *
+ * @param nr      Softirq number; SOFTIRQ_IRQ(irq) for an IRQ's bottom half.
+ * @param handler Runs with interrupts enabled; NULL removes it.
+ * @param ctx     Passed to @p handler.
+ *
+ * @return false if @p nr is out of range.
+ */
+bool softirq_register(uint32_t nr, softirq_handler_t handler, void *ctx)
+{
+    if (nr >= SOFTIRQ_MAX)
+    {
+        return false;
+    }
+
+    uint32_t flags = cpu_irq_save();
+    actions[nr].handler = handler;
+    actions[nr].ctx = ctx;
+    if (handler)
+    {
+        registered |= 1u << nr;
+    }
+    else
+    {
+        registered &= ~(1u << nr);
+    }
+    cpu_irq_restore(flags);
+    return true;
+}
+
+/**
+ * @brief Mark a softirq pending. Safe from any context.
+ *
+ * Does nothing for a softirq without a handler, so IRQ lines without a
+ * bottom half never cause a softirq pass.
+ */
+void softirq_raise(uint32_t nr)
+{
+    if (!(registered & (1u << nr)))
+    {
+        return;
+    }
+    __atomic_fetch_or(&pending, 1u << nr, __ATOMIC_RELAXED);
+    stats.raised[nr]++;
+}
+
+bool softirq_pending(void)
+{
+    return __atomic_load_n(&pending, __ATOMIC_RELAXED) != 0;
+}
+
+/**
+ * @brief Run pending softirqs with interrupts enabled.
+ *
+ * Called by irq_entry() after the EOI (interrupts off) and from the
+ * idle loop; returns with the interrupt flag as it found it.
+ */
+void softirq_run(void)
+{
+    uint32_t flags = cpu_irq_save();
+
+    if (running || !pending)
+    {
+        cpu_irq_restore(flags);
+        return;
+    }
+
+    running = true;
+    fpu_softirq_enter();
+    __asm__ volatile ("sti" : : : "memory");
+
+    uint64_t start = cpu_rdtsc();
+    for (uint32_t pass = 0; pass < SOFTIRQ_RESTARTS; pass++)
+    {
+        uint32_t bits = __atomic_exchange_n(&pending, 0, __ATOMIC_RELAXED);
+        if (!bits)
+        {
+            break;
+        }
+
+        while (bits)
+        {
+            uint32_t nr = __builtin_ctz(bits);
+            bits &= bits - 1;
+
+            if (actions[nr].handler)
+            {
+                stats.runs[nr]++;
+                actions[nr].handler(actions[nr].ctx);
+            }
+        }
+
+        if (softirq_budget && cpu_rdtsc() - start > softirq_budget && pending)
+        {
+            stats.deferred++;
+            break;
+        }
+    }
+
+    __asm__ volatile ("cli" : : : "memory");
+    fpu_softirq_exit();
+    running = false;
+    cpu_irq_restore(flags);
+}
+
+/**
+ * @brief Prepare a work item.
+ *
+ * @param fn  Runs from the idle loop, interrupts enabled.
+ * @param ctx Passed to @p fn.
+ */
+void work_init(work_t *work, void (*fn)(void *ctx), void *ctx)
+{
+    work->fn = fn;
+    work->ctx = ctx;
+    work->next = NULL;
+    work->queued = false;
+}
+
+/**
+ * @brief Queue a work item at the back. Safe from any context.
+ *
+ * @return false if it was already queued (it still runs once).
+ */
+bool work_queue(work_t *work)
+{
+    uint32_t flags = cpu_irq_save();
+
+    if (work->queued)
+    {
+        cpu_irq_restore(flags);
+        return false;
+    }
+
+    work->queued = true;
+    work->next = NULL;
+    if (work_tail)
+    {
+        work_tail->next = work;
+    }
+    else
+    {
+        work_head = work;
+    }
+    work_tail = work;
+
+    cpu_irq_restore(flags);
+    return true;
+}
+
+bool work_pending(void)
+{
+    return __atomic_load_n(&work_head, __ATOMIC_RELAXED) != NULL;
+}
+
+/**
+ * @brief Run queued work items, oldest first, until the queue is empty
+ *        or WORK_BUDGET_US has passed. Idle loop only.
+ */
+void workqueue_run(void)
+{
+    uint64_t start = cpu_rdtsc();
+
+    while (work_pending())
+    {
+        uint32_t flags = cpu_irq_save();
+        work_t *work = work_head;
+        work_head = work->next;
+        if (!work_head)
+        {
+            work_tail = NULL;
+        }
+        work->queued = false;           // May requeue itself from fn
+        cpu_irq_restore(flags);
+
+        stats.work_runs++;
+        work->fn(work->ctx);
+
+        if (work_budget && cpu_rdtsc() - start > work_budget && work_pending())
+        {
+            stats.work_deferred++;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Get the softirq and work queue counters.
+ *
+ * @param out Receives a copy of the counters.
+ */
+void softirq_get_stats(softirq_stats_t *out)
+{
+    *out = stats;
+}
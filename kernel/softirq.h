@@ -0,0 +1,47 @@
+#ifndef SOFTIRQ_H_
+#define SOFTIRQ_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SOFTIRQ_MAX 32                  // One bit each in the pending bitmap
+#define SOFTIRQ_IRQ(irq) (irq)          // 0-15: bottom half of an IRQ line
+#define SOFTIRQ_TIMER 16                // Expired timers (timer.c)
+
+#define SOFTIRQ_RESTARTS 4              // Passes per softirq_run() at most
+#define SOFTIRQ_BUDGET_US 500           // Time budget of one softirq_run()
+#define WORK_BUDGET_US 5000             // Time budget of one workqueue_run()
+
+typedef void (*softirq_handler_t)(void *ctx);
+
+typedef struct work work_t;
+
+struct work {
+    void (*fn)(void *ctx);
+    void *ctx;
+    work_t *next;
+    bool queued;                        // On the queue; work_queue() is then a no-op
+};
+
+typedef struct {
+    uint32_t raised[SOFTIRQ_MAX];       // softirq_raise() calls
+    uint32_t runs[SOFTIRQ_MAX];         // Handler invocations
+    uint32_t deferred;                  // softirq_run() passes cut short by the budget
+    uint32_t work_runs;                 // Work items run
+    uint32_t work_deferred;             // workqueue_run() passes cut short by the budget
+} softirq_stats_t;
+
+void softirq_init(void);
+bool softirq_register(uint32_t nr, softirq_handler_t handler, void *ctx);
+void softirq_raise(uint32_t nr);
+bool softirq_pending(void);
+void softirq_run(void);
+
+void work_init(work_t *work, void (*fn)(void *ctx), void *ctx);
+bool work_queue(work_t *work);
+bool work_pending(void);
+void workqueue_run(void);
+
+void softirq_get_stats(softirq_stats_t *stats);
+
+#endif
@@ -0,0 +1,594 @@
+/**
+ * timer.c
+ *
+ * Tickless Timers
+ *
+ * Drivers arm a ktimer_t with add_timer() and cancel it with
+ * del_timer(); its callback runs once the deadline has passed. There
+ * is no periodic tick: the PIT is armed as a one-shot (pit_arm()) for
+ * the next moment the wheel below has something to do, so an idle
+ * system takes no timer interrupts at all and a timeout is not rounded
+ * to a tick period, only to TIMER_TICK_NS.
+ *
+ * --------------------------------------------------------------------
+ * THE WHEEL
+ * --------------------------------------------------------------------
+ *
+ * Deadlines are kept in wheel ticks of TIMER_TICK_NS. `wheel_time` is
+ * the first tick not yet processed. A pending timer sits in one of
+ * TIMER_LEVELS levels of TIMER_SLOTS slots, chosen by how far away its
+ * deadline is:
+ *
+ *     level 0   deadline within 64 ticks; slot = deadline & 63
+ *     level n   deadline within 64^(n+1) ticks;
+ *               slot = (deadline >> 6n) & 63
+ *
+ * Each slot is an unsorted doubly linked list, so add_timer() and
+ * del_timer() are O(1) whatever the number of timers. Deadlines beyond
+ * the top level are parked in its furthest slot and re-filed when it
+ * comes round.
+ *
+ * When wheel_time reaches a multiple of 64^n, the level n slot for the
+ * next 64^n ticks is "cascaded": its timers are re-filed, which puts
+ * them on a lower level now that they are closer. Level 0 slots are
+ * expired as wheel_time passes them. A bitmap of occupied slots lets
+ * both the advance and the search for the next event skip empty slots
+ * a word at a time.
+ *
+ * --------------------------------------------------------------------
+ * INTERRUPTS
+ * --------------------------------------------------------------------
+ *
+ * The IRQ0 handler advances the wheel to the current time, moving
+ * every due timer onto the expired list in one batch, raises
+ * SOFTIRQ_TIMER and arms the PIT for the next event: the first
+ * occupied level 0 slot or the next cascade of an occupied slot,
+ * whichever is sooner. The PIT counts at most about 55 ms, so a later
+ * event takes an extra interrupt every 55 ms until it is in range.
+ *
+ * Callbacks run from the softirq, with interrupts enabled, and may
+ * re-arm their own timer. del_timer() does not touch the PIT: an
+ * interrupt armed for a cancelled timer finds nothing to do and
+ * re-arms for whatever is next.
+ *
+ */
+
+#include "timer.h"
+#include "cpu.h"
+#include "isr.h"
+#include "kprintf.h"
+#include "ktime.h"
+#include "math.h"
+#include "pit.h"
+#include "softirq.h"
+
+#include <stddef.h>
+
+#define SLOT_MASK (TIMER_SLOTS - 1)
+#define WHEEL_SLOTS (TIMER_LEVELS * TIMER_SLOTS)
+#define WHEEL_SPAN ((uint64_t)1 << (TIMER_SLOT_BITS * TIMER_LEVELS))
+#define BUCKET_EXPIRED WHEEL_SLOTS      // ktimer_t.bucket of an expired timer
+
+#define NO_EVENT UINT64_MAX
+#define PIT_MAX_NS ((uint64_t)PIT_MAX_COUNT * 1000000000 / PIT_FREQUENCY)
+
+static ktimer_t *wheel[WHEEL_SLOTS];
+static uint32_t occupied[WHEEL_SLOTS / 32];     // Bit per non-empty slot
+static uint64_t wheel_time;             // First tick not yet processed
+static uint32_t wheel_count;            // Timers in the wheel
+
+static ktimer_t *expired_head;           // Due, callback not yet run
+static ktimer_t **expired_tail = &expired_head;
+
+static bool active;
+static uint64_t armed_tick = NO_EVENT;  // Tick the PIT is armed for
+static uint64_t start_ns;               // ktime when timers_init() ran
+
+static timer_stats_t stats;
+
+static inline uint32_t level_shift(uint32_t level)
+{
+    return TIMER_SLOT_BITS * level;
+}
+
+static uint64_t now_tick(void)
+{
+    return udivmod64(ktime_get_ns(), TIMER_TICK_NS, NULL);
+}
+
+/**
+ * @brief Link a timer into a wheel slot.
+ */
+static void slot_link(ktimer_t *timer, uint32_t bucket)
+{
+    ktimer_t **head = &wheel[bucket];
+
+    timer->next = *head;
+    if (timer->next)
+    {
+        timer->next->pprev = &timer->next;
+    }
+    *head = timer;
+    timer->pprev = head;
+    timer->bucket = bucket;
+    occupied[bucket >> 5] |= 1u << (bucket & 31);
+}
+
+/**
+ * @brief Detach a whole slot list.
+ *
+ * @return First timer of the slot; the list is still linked by `next`.
+ */
+static ktimer_t *slot_take(uint32_t bucket)
+{
+    ktimer_t *list = wheel[bucket];
+
+    wheel[bucket] = NULL;
+    occupied[bucket >> 5] &= ~(1u << (bucket & 31));
+    return list;
+}
+
+/**
+ * @brief File a timer in the wheel by its distance from wheel_time.
+ */
+static void wheel_insert(ktimer_t *timer)
+{
+    uint64_t expires = timer->expires < wheel_time ? wheel_time : timer->expires;
+    uint64_t delta = expires - wheel_time;
+    uint32_t level = 0;
+
+    if (delta >= WHEEL_SPAN)
+    {
+        expires = wheel_time + WHEEL_SPAN - 1;  // Parked; re-filed on cascade
+        delta = WHEEL_SPAN - 1;
+    }
+    while (level < TIMER_LEVELS - 1 && (delta >> level_shift(level + 1)))
+    {
+        level++;
+    }
+
+    slot_link(timer, level * TIMER_SLOTS + ((uint32_t)(expires >> level_shift(level)) & SLOT_MASK));
+    wheel_count++;
+}
+
+/**
+ * @brief Remove a timer from the wheel or the expired list.
+ */
+static void timer_unlink(ktimer_t *timer)
+{
+    *timer->pprev = timer->next;
+    if (timer->next)
+    {
+        timer->next->pprev = timer->pprev;
+    }
+
+    if (timer->bucket == BUCKET_EXPIRED)
+    {
+        if (expired_tail == &timer->next)
+        {
+            expired_tail = timer->pprev;
+        }
+    }
+    else
+    {
+        wheel_count--;
+        if (!wheel[timer->bucket])
+        {
+            occupied[timer->bucket >> 5] &= ~(1u << (timer->bucket & 31));
+        }
+    }
+
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+/**
+ * @brief Find the first occupied slot of a level, starting at a slot.
+ *
+ * @param level Wheel level.
+ * @param from  Slot to start at; the search wraps round.
+ *
+ * @return Slots from @p from to the first occupied one, TIMER_SLOTS if
+ *         the level is empty.
+ */
+static uint32_t next_occupied(uint32_t level, uint32_t from)
+{
+    const uint32_t *bits = &occupied[level * TIMER_SLOTS / 32];
+    uint32_t distance = 0;
+
+    while (distance < TIMER_SLOTS)
+    {
+        uint32_t slot = (from + distance) & SLOT_MASK;
+        uint32_t word = bits[slot >> 5] >> (slot & 31);
+
+        if (word)
+        {
+            return distance + __builtin_ctz(word);
+        }
+        distance += 32 - (slot & 31);
+    }
+    return TIMER_SLOTS;
+}
+
+/**
+ * @brief Re-file the timers of the level slot that wheel_time has just
+ *        entered.
+ */
+static void cascade(uint32_t level)
+{
+    uint32_t slot = (uint32_t)(wheel_time >> level_shift(level)) & SLOT_MASK;
+    ktimer_t *timer = slot_take(level * TIMER_SLOTS + slot);
+
+    while (timer)
+    {
+        ktimer_t *next = timer->next;
+
+        wheel_count--;
+        wheel_insert(timer);
+        stats.cascaded++;
+        timer = next;
+    }
+}
+
+/**
+ * @brief Move the timers of a level 0 slot onto the expired list.
+ *
+ * @return Number of timers moved.
+ */
+static uint32_t expire_slot(uint32_t slot)
+{
+    ktimer_t *timer = slot_take(slot);
+    uint32_t count = 0;
+
+    while (timer)
+    {
+        ktimer_t *next = timer->next;
+
+        timer->bucket = BUCKET_EXPIRED;
+        timer->next = NULL;
+        timer->pprev = expired_tail;
+        *expired_tail = timer;
+        expired_tail = &timer->next;
+
+        wheel_count--;
+        count++;
+        timer = next;
+    }
+    return count;
+}
+
+/**
+ * @brief Process every tick up to and including @p now.
+ *
+ * Jumps straight to the next occupied level 0 slot or the next
+ * multiple of 64, so the cost is per occupied slot and per 64 ticks,
+ * not per tick.
+ *
+ * @return Number of timers that expired.
+ */
+static uint32_t wheel_advance(uint64_t now)
+{
+    uint32_t batch = 0;
+
+    while (wheel_time <= now)
+    {
+        uint32_t slot = (uint32_t)wheel_time & SLOT_MASK;
+        uint32_t skip = 1;
+
+        if (!slot)
+        {
+            for (uint32_t level = 1; level < TIMER_LEVELS; level++)
+            {
+                cascade(level);
+                if ((wheel_time >> level_shift(level)) & SLOT_MASK)
+                {
+                    break;
+                }
+            }
+        }
+        batch += expire_slot(slot);
+
+        if (slot != SLOT_MASK)
+        {
+            uint32_t distance = next_occupied(0, slot + 1);
+            uint32_t left = SLOT_MASK - slot;   // Slots after this one in the block
+
+            skip += distance < left ? distance : left;
+        }
+        wheel_time = wheel_time + skip <= now ? wheel_time + skip : now + 1;
+    }
+    return batch;
+}
+
+/**
+ * @brief Find the tick at which the wheel next needs processing.
+ *
+ * @return The tick, or NO_EVENT if the wheel is empty.
+ */
+static uint64_t wheel_next(void)
+{
+    uint64_t next = NO_EVENT;
+
+    if (!wheel_count)
+    {
+        return next;
+    }
+
+    uint32_t distance = next_occupied(0, (uint32_t)wheel_time & SLOT_MASK);
+    if (distance < TIMER_SLOTS)
+    {
+        next = wheel_time + distance;
+    }
+
+    for (uint32_t level = 1; level < TIMER_LEVELS; level++)
+    {
+        // First slot whose cascade point is at or after wheel_time
+        uint32_t shift = level_shift(level);
+        uint64_t block = (wheel_time + ((uint64_t)1 << shift) - 1) >> shift;
+
+        distance = next_occupied(level, (uint32_t)block & SLOT_MASK);
+        if (distance < TIMER_SLOTS && ((block + distance) << shift) < next)
+        {
+            next = (block + distance) << shift;
+        }
+    }
+    return next;
+}
+
+/**
+ * @brief Arm the PIT to interrupt at a wheel tick.
+ *
+ * Ticks already past get the shortest one-shot; ticks beyond the
+ * PIT's range get its longest.
+ */
+static void timer_arm(uint64_t tick)
+{
+    armed_tick = tick;
+    if (tick == NO_EVENT)
+    {
+        return;
+    }
+
+    uint64_t deadline = tick * TIMER_TICK_NS;
+    uint64_t now = ktime_get_ns();
+    uint32_t count = 1;
+
+    if (deadline > now)
+    {
+        uint64_t delta = deadline - now;
+
+        if (delta >= PIT_MAX_NS)
+        {
+            count = PIT_MAX_COUNT;
+        }
+        else
+        {
+            // Round up: an interrupt that comes early costs a re-arm
+            count = (uint32_t)udivmod64(delta * PIT_FREQUENCY, 1000000000, NULL) + 1;
+            if (count > PIT_MAX_COUNT)
+            {
+                count = PIT_MAX_COUNT;
+            }
+        }
+    }
+
+    pit_arm(count);
+    stats.reprograms++;
+}
+
+/**
+ * @brief IRQ0 handler: expire due timers and arm the next one-shot.
+ */
+static bool timer_interrupt(void *ctx)
+{
+    (void)ctx;
+    uint32_t batch = wheel_advance(now_tick());
+
+    stats.interrupts++;
+    if (batch)
+    {
+        if (batch > stats.max_batch)
+        {
+            stats.max_batch = batch;
+        }
+        softirq_raise(SOFTIRQ_TIMER);
+    }
+    else
+    {
+        stats.idle_interrupts++;
+    }
+
+    timer_arm(wheel_next());
+    return true;
+}
+
+/**
+ * @brief SOFTIRQ_TIMER: run the callbacks of expired timers.
+ */
+static void timer_softirq(void *ctx)
+{
+    (void)ctx;
+
+    for (;;)
+    {
+        uint32_t flags = cpu_irq_save();
+        ktimer_t *timer = expired_head;
+
+        if (!timer)
+        {
+            cpu_irq_restore(flags);
+            break;
+        }
+        timer_unlink(timer);
+        stats.expired++;
+        cpu_irq_restore(flags);
+
+        timer->fn(timer->ctx);
+    }
+}
+
+/**
+ * @brief Take over IRQ0 and start the timer core.
+ *
+ * Needs ktime_init() and the interrupt controller. The PIT is left in
+ * one-shot mode, which also stops the 18.2 Hz tick the BIOS set up.
+ */
+void timers_init(void)
+{
+    uint32_t flags = cpu_irq_save();
+
+    start_ns = ktime_get_ns();
+    if (!wheel_count)
+    {
+        wheel_time = now_tick();
+    }
+    softirq_register(SOFTIRQ_TIMER, timer_softirq, NULL);
+    irq_register(PIT_IRQ, timer_interrupt, NULL);
+    active = true;
+
+    timer_arm(wheel_next());
+    if (armed_tick == NO_EVENT)
+    {
+        pit_arm(PIT_MAX_COUNT);         // One last interrupt, then silence
+    }
+
+    cpu_irq_restore(flags);
+}
+
+/**
+ * @brief Check whether timer callbacks will run (timers_init() done).
+ */
+bool timers_active(void)
+{
+    return active;
+}
+
+/**
+ * @brief Prepare a timer for add_timer().
+ *
+ * @param timer Timer to set up.
+ * @param fn    Callback; runs in softirq context with interrupts enabled.
+ * @param ctx   Passed to @p fn.
+ */
+void timer_init(ktimer_t *timer, timer_fn_t fn, void *ctx)
+{
+    timer->expires = 0;
+    timer->fn = fn;
+    timer->ctx = ctx;
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->bucket = 0;
+}
+
+/**
+ * @brief Arm a timer, or move it if it is already pending.
+ *
+ * Safe from any context. The callback runs no earlier than
+ * @p expires_ns, rounded up to the next TIMER_TICK_NS.
+ *
+ * @param timer      Timer set up with timer_init().
+ * @param expires_ns Deadline on the ktime_get_ns() clock.
+ *
+ * @return true if the timer was pending (and has been moved).
+ */
+bool add_timer(ktimer_t *timer, uint64_t expires_ns)
+{
+    uint32_t rem;
+    uint64_t expires = udivmod64(expires_ns, TIMER_TICK_NS, &rem) + (rem ? 1 : 0);
+    uint32_t flags = cpu_irq_save();
+    bool was_pending = timer->pprev != NULL;
+
+    if (was_pending)
+    {
+        timer_unlink(timer);
+    }
+    if (!wheel_count)
+    {
+        // Nothing to process in between: skip the idle time outright
+        uint64_t now = now_tick();
+        if (wheel_time < now)
+        {
+            wheel_time = now;
+        }
+    }
+
+    timer->expires = expires;
+    wheel_insert(timer);
+    stats.added++;
+
+    if (active && expires < armed_tick)
+    {
+        timer_arm(expires);
+    }
+
+    cpu_irq_restore(flags);
+    return was_pending;
+}
+
+/**
+ * @brief Cancel a timer.
+ *
+ * Safe from any context, including the timer's own callback. Once this
+ * returns, the callback will not start (but may still be running if
+ * called from elsewhere while it runs).
+ *
+ * @return true if the timer was pending.
+ */
+bool del_timer(ktimer_t *timer)
+{
+    uint32_t flags = cpu_irq_save();
+    bool was_pending = timer->pprev != NULL;
+
+    if (was_pending)
+    {
+        timer_unlink(timer);
+        stats.cancelled++;
+    }
+
+    cpu_irq_restore(flags);
+    return was_pending;
+}
+
+/**
+ * @brief Check whether a timer is armed and its callback not yet started.
+ */
+bool timer_pending(const ktimer_t *timer)
+{
+    return timer->pprev != NULL;
+}
+
+/**
+ * @brief Get the timer counters.
+ *
+ * @param out Receives a copy of the counters, with periodic_ticks and
+ *            avoided computed for the time since timers_init().
+ */
+void timer_get_stats(timer_stats_t *out)
+{
+    uint32_t flags = cpu_irq_save();
+    *out = stats;
+    cpu_irq_restore(flags);
+
+    if (active)
+    {
+        uint64_t elapsed = ktime_get_ns() - start_ns;
+        out->periodic_ticks = (uint32_t)udivmod64(elapsed * TIMER_REFERENCE_HZ, 1000000000, NULL);
+    }
+    out->avoided = out->periodic_ticks > out->interrupts ? out->periodic_ticks - out->interrupts : 0;
+}
+
+/**
+ * @brief Print the timer counters.
+ */
+void timer_print_stats(void)
+{
+    timer_stats_t ts;
+    timer_get_stats(&ts);
+
+    kprintf("Timers: %u added, %u cancelled, %u expired, %u cascaded\n",
+            ts.added, ts.cancelled, ts.expired, ts.cascaded);
+    kprintf("Timer interrupts: %u (%u with nothing due, at most %u timers per batch), %u one-shots armed\n",
+            ts.interrupts, ts.idle_interrupts, ts.max_batch, ts.reprograms);
+    kprintf("A %u Hz periodic tick would have taken %u: %u avoided\n",
+            TIMER_REFERENCE_HZ, ts.periodic_ticks, ts.avoided);
+}
@@ -0,0 +1,48 @@
+#ifndef TIMER_H_
+#define TIMER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TIMER_TICK_NS 100000            // Wheel resolution (100 us)
+#define TIMER_SLOT_BITS 6
+#define TIMER_SLOTS (1u << TIMER_SLOT_BITS)     // Slots per wheel level
+#define TIMER_LEVELS 5                  // 64^5 ticks: about 30 hours
+#define TIMER_REFERENCE_HZ 1000         // Periodic tick the "avoided" count is measured against
+
+typedef void (*timer_fn_t)(void *ctx);
+
+typedef struct ktimer ktimer_t;
+
+struct ktimer {
+    uint64_t expires;                   // Deadline in wheel ticks
+    timer_fn_t fn;
+    void *ctx;
+    ktimer_t *next;
+    ktimer_t **pprev;                    // Link pointing at this timer; NULL if idle
+    uint16_t bucket;                    // Wheel slot (level * TIMER_SLOTS + slot)
+};
+
+typedef struct {
+    uint32_t added;                     // add_timer() calls
+    uint32_t cancelled;                 // del_timer() calls that removed a pending timer
+    uint32_t expired;                   // Callbacks run
+    uint32_t interrupts;                // Timer interrupts taken
+    uint32_t idle_interrupts;           // ...that expired nothing (PIT range limit or cascade)
+    uint32_t max_batch;                 // Most timers expired by one interrupt
+    uint32_t cascaded;                  // Timers moved down a wheel level
+    uint32_t reprograms;                // PIT one-shots armed
+    uint32_t periodic_ticks;            // Interrupts a TIMER_REFERENCE_HZ periodic tick would have taken
+    uint32_t avoided;                   // periodic_ticks - interrupts
+} timer_stats_t;
+
+void timers_init(void);
+bool timers_active(void);
+void timer_init(ktimer_t *timer, timer_fn_t fn, void *ctx);
+bool add_timer(ktimer_t *timer, uint64_t expires_ns);
+bool del_timer(ktimer_t *timer);
+bool timer_pending(const ktimer_t *timer);
+void timer_get_stats(timer_stats_t *stats);
+void timer_print_stats(void);
+
+#endif
@@ -0,0 +1,250 @@
+/**
+ * vmm.c
+ *
+ * Virtual Memory Manager (32-bit, non-PAE paging)
+ *
+ * --------------------------------------------------------------------
+ * LAYOUT
+ * --------------------------------------------------------------------
+ *
+ * All physical RAM the PMM manages (and everything below it, including
+ * the kernel, low memory and the VGA hole) is identity-mapped with
+ * 4 MiB PSE pages straight from the page directory. One TLB entry then
+ * covers 1024 pages, and pointers returned by the PMM stay usable as-is.
+ *
+ * Those kernel mappings are marked global when the CPU supports PGE, so
+ * they are not flushed when CR3 is reloaded.
+ *
+ * Anything above the identity-mapped range (device memory such as the
+ * local APIC or a linear framebuffer) is mapped with 4 KiB pages through
+ * vmm_map(). Page tables are allocated from the PMM on demand.
+ *
+ * --------------------------------------------------------------------
+ * TLB MAINTENANCE
+ * --------------------------------------------------------------------
+ *
+ * Changing or removing a 4 KiB mapping invalidates only that page with
+ * `invlpg`; CR3 is never reloaded to flush the TLB.
+ *
+ * Without PSE support, the identity range falls back to 4 KiB pages
+ * built with the same vmm_map() path.
+ *
+ */
+
+#include "vmm.h"
+#include "cpu.h"
+#include "kprintf.h"
+#include "memory.h"
+#include "pmm.h"
+
+#include <stddef.h>
+
+#define PDE_LARGE           0x080       // PS bit: entry maps a 4 MiB page
+#define ENTRY_ADDR_MASK     0xFFFFF000
+#define ENTRIES_PER_TABLE   1024
+
+#define PD_INDEX(addr)      ((addr) >> 22)
+#define PT_INDEX(addr)      (((addr) >> 12) & 0x3FF)
+
+__attribute__((aligned(PAGE_SIZE)))
+static uint32_t page_directory[ENTRIES_PER_TABLE];
+
+static uint32_t identity_end;           // Identity-mapped range is [0, identity_end)
+static uint32_t global_flag;            // VMM_GLOBAL if the CPU supports PGE, else 0
+
+/**
+ * @brief Get the page table covering a virtual address.
+ *
+ * @param virt   Virtual address.
+ * @param create Allocate and install an empty table if none exists.
+ *
+ * @return The page table, or NULL if it doesn't exist (and create is
+ *         false), allocation failed, or the address lies in a 4 MiB page.
+ */
+static uint32_t *vmm_get_table(uint32_t virt, bool create)
+{
+    uint32_t *pde = &page_directory[PD_INDEX(virt)];
+
+    if (*pde & VMM_PRESENT)
+    {
+        if (*pde & PDE_LARGE)
+        {
+            return NULL;
+        }
+        return (uint32_t *)(*pde & ENTRY_ADDR_MASK);
+    }
+
+    if (!create)
+    {
+        return NULL;
+    }
+
+    uint32_t table = pmm_alloc_page();
+    if (!table)
+    {
+        return NULL;
+    }
+    memset((void *)table, 0, PAGE_SIZE);
+
+    // Leave USER/WRITE permissive at the directory level; the PTE decides
+    *pde = table | VMM_PRESENT | VMM_WRITE | VMM_USER;
+    return (uint32_t *)table;
+}
+
+/**
+ * @brief Map one 4 KiB page.
+ *
+ * Replaces any existing mapping of @p virt and invalidates its TLB entry.
+ *
+ * @param virt  Page-aligned virtual address.
+ * @param phys  Page-aligned physical address.
+ * @param flags VMM_* flags; VMM_PRESENT is implied.
+ *
+ * @return true on success, false if the address is covered by a 4 MiB
+ *         identity page or no page table could be allocated.
+ */
+bool vmm_map(uint32_t virt, uint32_t phys, uint32_t flags)
+{
+    uint32_t *table = vmm_get_table(virt, true);
+    if (!table)
+    {
+        return false;
+    }
+
+    uint32_t *pte = &table[PT_INDEX(virt)];
+    bool was_present = *pte & VMM_PRESENT;
+
+    *pte = (phys & ENTRY_ADDR_MASK) | (flags & ~ENTRY_ADDR_MASK) | VMM_PRESENT;
+    if (was_present)
+    {
+        cpu_invlpg(virt);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Remove the 4 KiB mapping of a virtual address.
+ *
+ * Does nothing if the page isn't mapped through a page table. The page
+ * table itself is kept for later mappings.
+ *
+ * @param virt Page-aligned virtual address.
+ */
+void vmm_unmap(uint32_t virt)
+{
+    uint32_t *table = vmm_get_table(virt, false);
+    if (!table)
+    {
+        return;
+    }
+
+    uint32_t *pte = &table[PT_INDEX(virt)];
+    if (*pte & VMM_PRESENT)
+    {
+        *pte = 0;
+        cpu_invlpg(virt);
+    }
+}
+
+/**
+ * @brief Look up the physical address a virtual address maps to.
+ *
+ * @param virt Virtual address.
+ * @param phys Output for the physical address.
+ *
+ * @return true if @p virt is mapped.
+ */
+bool vmm_translate(uint32_t virt, uint32_t *phys)
+{
+    uint32_t pde = page_directory[PD_INDEX(virt)];
+
+    if (!(pde & VMM_PRESENT))
+    {
+        return false;
+    }
+    if (pde & PDE_LARGE)
+    {
+        *phys = (pde & 0xFFC00000) | (virt & 0x3FFFFF);
+        return true;
+    }
+
+    uint32_t pte = ((uint32_t *)(pde & ENTRY_ADDR_MASK))[PT_INDEX(virt)];
+    if (!(pte & VMM_PRESENT))
+    {
+        return false;
+    }
+    *phys = (pte & ENTRY_ADDR_MASK) | (virt & 0xFFF);
+    return true;
+}
+
+/**
+ * @brief Get the end of the identity-mapped range.
+ *
+ * @return Physical/virtual addresses below this value map to themselves.
+ */
+uint32_t vmm_identity_end(void)
+{
+    return identity_end;
+}
+
+/**
+ * @brief Build the kernel page directory and enable paging.
+ *
+ * Must run after pmm_init(), which determines how much memory to
+ * identity-map and provides page tables.
+ */
+void vmm_init(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+    cpu_cpuid(1, &eax, &ebx, &ecx, &edx);
+
+    bool has_pse = edx & CPUID_EDX_PSE;
+    global_flag = (edx & CPUID_EDX_PGE) ? VMM_GLOBAL : 0;
+
+    // Always cover at least the first 4 MiB (kernel, stack, VGA)
+    uint32_t end = pmm_memory_end();
+    if (end < VMM_LARGE_PAGE_SIZE)
+    {
+        end = VMM_LARGE_PAGE_SIZE;
+    }
+    end = (end + VMM_LARGE_PAGE_SIZE - 1) & ~(VMM_LARGE_PAGE_SIZE - 1);
+    if (end == 0)
+    {
+        end = 0xFFC00000;               // Rounded past 4 GiB; keep the top 4 MiB unmapped
+    }
+
+    if (has_pse)
+    {
+        cpu_write_cr4(cpu_read_cr4() | CR4_PSE);
+        for (uint32_t addr = 0; addr < end; addr += VMM_LARGE_PAGE_SIZE)
+        {
+            page_directory[PD_INDEX(addr)] = addr | PDE_LARGE | global_flag | VMM_WRITE | VMM_PRESENT;
+        }
+        identity_end = end;
+    }
+    else
+    {
+        // Paging is still off, so new page tables are reachable directly
+        for (uint32_t addr = 0; addr < end; addr += PAGE_SIZE)
+        {
+            if (!vmm_map(addr, addr, global_flag | VMM_WRITE))
+            {
+                break;
+            }
+            identity_end = addr + PAGE_SIZE;
+        }
+    }
+
+    cpu_write_cr3((uint32_t)page_directory);
+    cpu_write_cr0(cpu_read_cr0() | CR0_PG | CR0_WP);
+    if (global_flag)
+    {
+        cpu_write_cr4(cpu_read_cr4() | CR4_PGE);
+    }
+
+    kprintf("Paging enabled: %u MiB identity-mapped with %s pages%s\n",
+            identity_end >> 20,
+            has_pse ? "4 MiB" : "4 KiB",
+            global_flag ? " (global)" : "");
+}
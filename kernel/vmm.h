@@ -0,0 +1,23 @@
+#ifndef VMM_H_
+#define VMM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Page table entry flags accepted by vmm_map()
+#define VMM_PRESENT         0x001
+#define VMM_WRITE           0x002
+#define VMM_USER            0x004
+#define VMM_WRITE_THROUGH   0x008
+#define VMM_NO_CACHE        0x010
+#define VMM_GLOBAL          0x100       // Kept in the TLB across CR3 reloads (needs CR4.PGE)
+
+#define VMM_LARGE_PAGE_SIZE 0x400000    // 4 MiB PSE page
+
+void vmm_init(void);
+bool vmm_map(uint32_t virt, uint32_t phys, uint32_t flags);
+void vmm_unmap(uint32_t virt);
+bool vmm_translate(uint32_t virt, uint32_t *phys);
+uint32_t vmm_identity_end(void);
+
+#endif
@@ -0,0 +1,159 @@
+/**
+ * arena.c
+ *
+ * Arena (Bump) Allocator
+ *
+ * An arena hands out memory from one caller-supplied buffer by moving
+ * a single offset forward. There is no per-object free: memory is
+ * given back all at once, either completely (arena_reset()) or back to
+ * a point recorded earlier (arena_mark() / arena_release()).
+ *
+ * --------------------------------------------------------------------
+ * SCOPES
+ * --------------------------------------------------------------------
+ *
+ * A mark is just the current offset, so scopes nest naturally:
+ *
+ *     arena_mark_t mark = arena_mark(&arena);
+ *     char *tmp = arena_alloc(&arena, 256);
+ *     ...                                    // use tmp
+ *     arena_release(&arena, mark);           // tmp and anything after it is gone
+ *
+ * --------------------------------------------------------------------
+ * ALIGNMENT
+ * --------------------------------------------------------------------
+ *
+ * arena_alloc() aligns to ARENA_DEFAULT_ALIGN. arena_alloc_aligned()
+ * accepts any power-of-two alignment; the padding it skips is simply
+ * part of the bump.
+ *
+ * Arenas are not locked. An arena shared with interrupt handlers needs
+ * external protection.
+ *
+ */
+
+#include "arena.h"
+#include "memory.h"
+
+/**
+ * @brief Initialize an arena over a buffer.
+ *
+ * @param arena  Arena to initialize.
+ * @param buffer Backing memory; owned by the caller.
+ * @param size   Size of @p buffer in bytes.
+ */
+void arena_init(arena_t *arena, void *buffer, size_t size)
+{
+    arena->base = (uint8_t *)buffer;
+    arena->size = buffer ? size : 0;
+    arena->used = 0;
+    arena->peak = 0;
+}
+
+/**
+ * @brief Allocate memory with a specific alignment.
+ *
+ * @param arena Arena to allocate from.
+ * @param size  Number of bytes.
+ * @param align Alignment in bytes; must be a power of two.
+ *
+ * @return Pointer to the memory, or NULL if the arena is exhausted.
+ */
+void *arena_alloc_aligned(arena_t *arena, size_t size, size_t align)
+{
+    uintptr_t current = (uintptr_t)arena->base + arena->used;
+    uintptr_t aligned = (current + align - 1) & ~(uintptr_t)(align - 1);
+    size_t offset = arena->used + (aligned - current);
+
+    if (offset > arena->size || size > arena->size - offset)
+    {
+        return NULL;
+    }
+
+    arena->used = offset + size;
+    if (arena->used > arena->peak)
+    {
+        arena->peak = arena->used;
+    }
+
+    return (void *)aligned;
+}
+
+/**
+ * @brief Allocate memory aligned to ARENA_DEFAULT_ALIGN.
+ *
+ * @param arena Arena to allocate from.
+ * @param size  Number of bytes.
+ *
+ * @return Pointer to the memory, or NULL if the arena is exhausted.
+ */
+void *arena_alloc(arena_t *arena, size_t size)
+{
+    return arena_alloc_aligned(arena, size, ARENA_DEFAULT_ALIGN);
+}
+
+/**
+ * @brief Allocate zero-filled memory aligned to ARENA_DEFAULT_ALIGN.
+ *
+ * @param arena Arena to allocate from.
+ * @param size  Number of bytes.
+ *
+ * @return Pointer to the memory, or NULL if the arena is exhausted.
+ */
+void *arena_zalloc(arena_t *arena, size_t size)
+{
+    void *ptr = arena_alloc(arena, size);
+    if (ptr)
+    {
+        memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+/**
+ * @brief Record the current allocation point.
+ *
+ * @param arena Arena to mark.
+ *
+ * @return Mark to pass to arena_release().
+ */
+arena_mark_t arena_mark(const arena_t *arena)
+{
+    return arena->used;
+}
+
+/**
+ * @brief Free everything allocated since @p mark was taken.
+ *
+ * @param arena Arena to roll back.
+ * @param mark  Value returned by arena_mark() on this arena.
+ */
+void arena_release(arena_t *arena, arena_mark_t mark)
+{
+    if (mark <= arena->used)
+    {
+        arena->used = mark;
+    }
+}
+
+/**
+ * @brief Free everything in the arena.
+ *
+ * @param arena Arena to empty.
+ */
+void arena_reset(arena_t *arena)
+{
+    arena->used = 0;
+}
+
+/**
+ * @brief Get the number of bytes still available (before alignment).
+ *
+ * @param arena Arena to query.
+ *
+ * @return Free bytes at the end of the arena.
+ */
+size_t arena_remaining(const arena_t *arena)
+{
+    return arena->size - arena->used;
+}
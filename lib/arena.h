@@ -0,0 +1,27 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARENA_DEFAULT_ALIGN 8
+
+typedef struct {
+    uint8_t *base;
+    size_t size;
+    size_t used;
+    size_t peak;                        // High-water mark of `used`
+} arena_t;
+
+typedef size_t arena_mark_t;
+
+void arena_init(arena_t *arena, void *buffer, size_t size);
+void *arena_alloc(arena_t *arena, size_t size);
+void *arena_alloc_aligned(arena_t *arena, size_t size, size_t align);
+void *arena_zalloc(arena_t *arena, size_t size);
+arena_mark_t arena_mark(const arena_t *arena);
+void arena_release(arena_t *arena, arena_mark_t mark);
+void arena_reset(arena_t *arena);
+size_t arena_remaining(const arena_t *arena);
+
+#endif
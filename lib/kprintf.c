@@ -1,79 +1,691 @@
+/**
+ * kprintf.c
+ *
+ * Formatted Output
+ *
+ * kprintf() prints to the console; ksnprintf()/kvsnprintf() format
+ * into a caller's buffer. Both run the same engine, format(), which
+ * writes into an fmt_out_t:
+ *
+ *     buffer sink   (ksnprintf)  - output past the end of the buffer is
+ *                                  dropped but still counted, so the
+ *                                  return value is the full length
+ *     console sink  (kprintf)    - a KPRINTF_BUFFER stack buffer handed
+ *                                  to screen_write() and serial_write()
+ *                                  when full and at the end, so a line
+ *                                  costs one write per console
+ *
+ * --------------------------------------------------------------------
+ * CONVERSIONS
+ * --------------------------------------------------------------------
+ *
+ *     %[flags][width][.precision][length]conversion
+ *
+ *     flags       - + space # 0
+ *     width       number or *
+ *     precision   number or *; minimum digits for integers, maximum
+ *                 characters for %s
+ *     length      hh h l ll z
+ *     conversion  d i u x X o c s p %
+ *
+ * Unknown conversions print nothing, as before.
+ *
+ * --------------------------------------------------------------------
+ * INTEGER CONVERSION
+ * --------------------------------------------------------------------
+ *
+ * Digits are produced right to left straight into a small buffer, so
+ * no reversal copy is needed:
+ *
+ *     decimal     two digits per step from a "00".."99" table, so one
+ *                 division by 100 (a multiply, for a constant) per two
+ *                 digits. 64-bit values are cut into 9-digit chunks
+ *                 with udivmod64() and the chunks use the 32-bit path.
+ *     hex, octal  shift and mask; no division at all.
+ *
+ */
+
 #include "kprintf.h"
 #include "screen.h"
-#include "string.h"
+#include "serial.h"
+#include "math.h"
 
+#include <stdbool.h>
 #include <stdint.h>
-#include <stdarg.h>
 
-void kprintf(const char *fmt, ...)
+#define KPRINTF_BUFFER 256
+
+// Flags of a conversion specification
+#define FMT_LEFT    0x01                // '-'
+#define FMT_PLUS    0x02                // '+'
+#define FMT_SPACE   0x04                // ' '
+#define FMT_ALT     0x08                // '#'
+#define FMT_ZERO    0x10                // '0'
+
+typedef enum {
+    FMT_LEN_INT = 0,
+    FMT_LEN_CHAR,                       // hh
+    FMT_LEN_SHORT,                      // h
+    FMT_LEN_LONG,                       // l, z
+    FMT_LEN_LONG_LONG,                  // ll
+} fmt_length_t;
+
+typedef struct {
+    uint32_t flags;                     // FMT_*
+    int32_t width;
+    int32_t precision;                  // -1 if none was given
+    fmt_length_t length;
+} fmt_spec_t;
+
+typedef struct fmt_out fmt_out_t;
+
+struct fmt_out {
+    char *buf;
+    size_t size;                        // Capacity of buf
+    size_t len;                         // Characters in buf
+    size_t total;                       // Characters produced so far
+    void (*flush)(fmt_out_t *out);      // Empties buf; NULL drops the excess
+};
+
+// Large enough for a 64-bit value in octal
+#define FMT_DIGITS_MAX 24
+
+static const char digit_pairs[200] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const char hex_lower[16] = "0123456789abcdef";
+static const char hex_upper[16] = "0123456789ABCDEF";
+
+/* ------------------------------------------------------------------ */
+/*  Sinks                                                             */
+/* ------------------------------------------------------------------ */
+
+static void out_write(fmt_out_t *out, const char *s, size_t n)
 {
-    if (!fmt) return;
+    out->total += n;
 
-    va_list args;
-    va_start(args, fmt);
-    while(*fmt)
+    while (n)
+    {
+        if (out->len == out->size)
+        {
+            if (!out->flush)
+            {
+                return;
+            }
+            out->flush(out);
+        }
+
+        size_t room = out->size - out->len;
+        size_t chunk = n < room ? n : room;
+        char *d = out->buf + out->len;
+
+        out->len += chunk;
+        n -= chunk;
+        while (chunk--)
+        {
+            *d++ = *s++;
+        }
+    }
+}
+
+/**
+ * @brief Copy a string up to its NUL or @p stop, whichever comes first.
+ *
+ * @return Pointer to the character that ended the copy.
+ */
+static const char *out_copy(fmt_out_t *out, const char *s, char stop)
+{
+    char *start = out->buf + out->len;
+    char *d = start;
+    char *limit = out->buf + out->size;
+
+    while (*s && *s != stop)
+    {
+        if (d == limit)
+        {
+            // Full: let out_write() flush or drop, then carry on
+            out->total += d - start;
+            out->len = out->size;
+            out_write(out, s++, 1);
+            start = d = out->buf + out->len;
+            continue;
+        }
+        *d++ = *s++;
+    }
+
+    out->total += d - start;
+    out->len = d - out->buf;
+    return s;
+}
+
+static void out_pad(fmt_out_t *out, char c, int32_t n)
+{
+    static const char spaces[16] = "                ";
+    static const char zeros[16] = "0000000000000000";
+    const char *run = c == '0' ? zeros : spaces;
+
+    while (n > 0)
+    {
+        size_t chunk = n < 16 ? (size_t) n : 16;
+        out_write(out, run, chunk);
+        n -= chunk;
+    }
+}
+
+static void console_flush(fmt_out_t *out)
+{
+    screen_write(out->buf, out->len);
+    serial_write(out->buf, out->len);
+    out->len = 0;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Integer conversion                                                */
+/* ------------------------------------------------------------------ */
+
+/**
+ * @brief Write a 32-bit value in decimal, ending just before @p end.
+ *
+ * @return Pointer to the first digit.
+ */
+static char *dec32(char *end, uint32_t value)
+{
+    while (value >= 100)
+    {
+        uint32_t quotient = value / 100;
+        uint32_t pair = value - quotient * 100;
+        value = quotient;
+        end -= 2;
+        end[0] = digit_pairs[pair * 2];
+        end[1] = digit_pairs[pair * 2 + 1];
+    }
+
+    if (value >= 10)
+    {
+        end -= 2;
+        end[0] = digit_pairs[value * 2];
+        end[1] = digit_pairs[value * 2 + 1];
+    }
+    else
+    {
+        *--end = (char) ('0' + value);
+    }
+
+    return end;
+}
+
+/**
+ * @brief Write a 64-bit value in decimal, ending just before @p end.
+ *
+ * @return Pointer to the first digit.
+ */
+static char *dec64(char *end, uint64_t value)
+{
+    while (value >> 32)
+    {
+        uint32_t chunk;
+        value = udivmod64(value, 1000000000, &chunk);
+
+        // Every chunk but the leading one is exactly nine digits
+        char *start = dec32(end, chunk);
+        end -= 9;
+        while (start > end)
+        {
+            *--start = '0';
+        }
+    }
+
+    return dec32(end, (uint32_t) value);
+}
+
+/**
+ * @brief Write a value in a power-of-two base, ending just before @p end.
+ *
+ * @param shift  Bits per digit (3 for octal, 4 for hex).
+ * @param digits Digit characters.
+ *
+ * @return Pointer to the first digit.
+ */
+static char *pow2(char *end, uint64_t value, uint32_t shift, const char *digits)
+{
+    uint32_t mask = (1u << shift) - 1;
+
+    if (!(value >> 32))
+    {
+        uint32_t low = (uint32_t) value;
+        do
+        {
+            *--end = digits[low & mask];
+            low >>= shift;
+        } while (low);
+        return end;
+    }
+
+    do
+    {
+        *--end = digits[(uint32_t) value & mask];
+        value >>= shift;
+    } while (value);
+    return end;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Engine                                                            */
+/* ------------------------------------------------------------------ */
+
+/**
+ * @brief Emit converted digits with sign/prefix, precision and padding.
+ *
+ * @param digits  First digit.
+ * @param ndigits Number of digits (0 for a zero printed with ".0").
+ * @param prefix  Sign or base prefix, "" if none.
+ */
+static void emit_number(fmt_out_t *out, const fmt_spec_t *spec,
+                        const char *digits, int32_t ndigits, const char *prefix)
+{
+    if (spec->width == 0 && spec->precision < 0 && !*prefix)
+    {
+        out_write(out, digits, ndigits);
+        return;
+    }
+
+    int32_t nprefix = 0;
+    while (prefix[nprefix])
+    {
+        nprefix++;
+    }
+
+    int32_t zeros = spec->precision > ndigits ? spec->precision - ndigits : 0;
+    int32_t pad = spec->width - nprefix - zeros - ndigits;
+
+    if ((spec->flags & FMT_ZERO) && !(spec->flags & FMT_LEFT) && spec->precision < 0 && pad > 0)
+    {
+        zeros += pad;
+        pad = 0;
+    }
+
+    if (!(spec->flags & FMT_LEFT))
+    {
+        out_pad(out, ' ', pad);
+    }
+    out_write(out, prefix, nprefix);
+    out_pad(out, '0', zeros);
+    out_write(out, digits, ndigits);
+    if (spec->flags & FMT_LEFT)
+    {
+        out_pad(out, ' ', pad);
+    }
+}
+
+/**
+ * @brief Emit a string, cut to the precision and padded to the width.
+ */
+static void emit_string(fmt_out_t *out, const fmt_spec_t *spec, const char *str, int32_t len)
+{
+    if (spec->precision >= 0 && len > spec->precision)
+    {
+        len = spec->precision;
+    }
+
+    int32_t pad = spec->width - len;
+
+    if (!(spec->flags & FMT_LEFT))
+    {
+        out_pad(out, ' ', pad);
+    }
+    out_write(out, str, len);
+    if (spec->flags & FMT_LEFT)
+    {
+        out_pad(out, ' ', pad);
+    }
+}
+
+// Fetch an argument of any length but ll (int and long are 32 bits here)
+static int32_t arg_signed(fmt_length_t length, va_list *args)
+{
+    int32_t value = va_arg(*args, int);
+
+    if (length == FMT_LEN_CHAR)
+    {
+        return (signed char) value;
+    }
+    if (length == FMT_LEN_SHORT)
+    {
+        return (short) value;
+    }
+    return value;
+}
+
+static uint32_t arg_unsigned(fmt_length_t length, va_list *args)
+{
+    uint32_t value = va_arg(*args, unsigned int);
+
+    if (length == FMT_LEN_CHAR)
+    {
+        return (unsigned char) value;
+    }
+    if (length == FMT_LEN_SHORT)
+    {
+        return (unsigned short) value;
+    }
+    return value;
+}
+
+/**
+ * @brief Parse a width or precision: digits or '*'.
+ */
+static int32_t parse_number(const char **fmt, va_list *args)
+{
+    if (**fmt == '*')
+    {
+        (*fmt)++;
+        return va_arg(*args, int);
+    }
+
+    int32_t value = 0;
+    while (**fmt >= '0' && **fmt <= '9')
+    {
+        value = value * 10 + (**fmt - '0');
+        (*fmt)++;
+    }
+    return value;
+}
+
+/**
+ * @brief Parse flags, width, precision and length of a conversion.
+ *
+ * @param spec Receives the specification; starts out as the defaults.
+ * @param fmt  Points just past the '%'; left at the conversion letter.
+ */
+static void parse_spec(fmt_spec_t *spec, const char **fmt, va_list *args)
+{
+    for (;; (*fmt)++)
+    {
+        if (**fmt == '-')      spec->flags |= FMT_LEFT;
+        else if (**fmt == '+') spec->flags |= FMT_PLUS;
+        else if (**fmt == ' ') spec->flags |= FMT_SPACE;
+        else if (**fmt == '#') spec->flags |= FMT_ALT;
+        else if (**fmt == '0') spec->flags |= FMT_ZERO;
+        else break;
+    }
+
+    spec->width = parse_number(fmt, args);
+    if (spec->width < 0)
+    {
+        spec->flags |= FMT_LEFT;        // A negative '*' width means left-justify
+        spec->width = -spec->width;
+    }
+
+    if (**fmt == '.')
+    {
+        (*fmt)++;
+        spec->precision = parse_number(fmt, args);
+        if (spec->precision < 0)
+        {
+            spec->precision = -1;
+        }
+    }
+
+    if (**fmt == 'h')
+    {
+        (*fmt)++;
+        spec->length = FMT_LEN_SHORT;
+        if (**fmt == 'h')
+        {
+            (*fmt)++;
+            spec->length = FMT_LEN_CHAR;
+        }
+    }
+    else if (**fmt == 'l')
     {
-        if (*fmt == '%')
+        (*fmt)++;
+        spec->length = FMT_LEN_LONG;
+        if (**fmt == 'l')
+        {
+            (*fmt)++;
+            spec->length = FMT_LEN_LONG_LONG;
+        }
+    }
+    else if (**fmt == 'z')
+    {
+        (*fmt)++;
+        spec->length = FMT_LEN_LONG;
+    }
+}
+
+/**
+ * @brief Format @p fmt into @p out.
+ */
+static void format(fmt_out_t *out, const char *fmt, va_list *args)
+{
+    while (*fmt)
+    {
+        // Copy the literal text up to the next conversion
+        fmt = out_copy(out, fmt, '%');
+        if (!*fmt)
+        {
+            break;
+        }
+
+        fmt++;                          // Skip '%'
+
+        fmt_spec_t spec = { 0, 0, -1, FMT_LEN_INT };
+
+        // Plain "%d" and friends skip straight to the conversion
+        if (*fmt < 'a' || *fmt == 'h' || *fmt == 'l' || *fmt == 'z')
+        {
+            parse_spec(&spec, &fmt, args);
+        }
+
+        char conv = *fmt;
+        if (conv == '\0')
         {
-            char tmp[32]; // temp buffer
-            // Skip % and move to next char
-            fmt++;
-            // Guard if after % is nothing
-            if (*fmt == '\0') break;
+            break;
+        }
+        fmt++;
+
+        char tmp[FMT_DIGITS_MAX];
+        char *end = tmp + sizeof(tmp);
+        char *digits = end;
+        const char *prefix = "";
 
-            if (*fmt == 'd' || *fmt == 'i')
+        switch (conv)
+        {
+        case 'd':
+        case 'i':
+        {
+            bool negative;
+
+            if (spec.length == FMT_LEN_LONG_LONG)
             {
-                itoa(va_arg(args, int), tmp, 10);
-                screen_print(tmp);
+                int64_t value = va_arg(*args, long long);
+                uint64_t magnitude = value < 0 ? 0 - (uint64_t) value : (uint64_t) value;
+
+                negative = value < 0;
+                if (magnitude || spec.precision != 0)
+                {
+                    digits = dec64(end, magnitude);
+                }
             }
-            else if (*fmt == 'c')
+            else
             {
-                screen_putc((char)va_arg(args, int));
+                int32_t value = arg_signed(spec.length, args);
+                uint32_t magnitude = value < 0 ? 0 - (uint32_t) value : (uint32_t) value;
+
+                negative = value < 0;
+                if (magnitude || spec.precision != 0)
+                {
+                    digits = dec32(end, magnitude);
+                }
             }
-            else if (*fmt == 's')
+
+            prefix = negative ? "-" : (spec.flags & FMT_PLUS) ? "+" : (spec.flags & FMT_SPACE) ? " " : "";
+            emit_number(out, &spec, digits, end - digits, prefix);
+            break;
+        }
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+        {
+            uint64_t value = spec.length == FMT_LEN_LONG_LONG
+                           ? va_arg(*args, unsigned long long)
+                           : arg_unsigned(spec.length, args);
+
+            if (value || spec.precision != 0)
             {
-                const char *str = va_arg(args, const char *);
-                if (str)
+                if (conv == 'u')
                 {
-                    screen_print(str);
+                    digits = value >> 32 ? dec64(end, value) : dec32(end, (uint32_t) value);
+                }
+                else if (conv == 'o')
+                {
+                    digits = pow2(end, value, 3, hex_lower);
                 }
                 else
                 {
-                    screen_print("(null)");
+                    digits = pow2(end, value, 4, conv == 'X' ? hex_upper : hex_lower);
                 }
             }
-            else if (*fmt == 'u')
-            {
-                utoa(va_arg(args, uint32_t), tmp, 10);
-                screen_print(tmp);
-            }
-            else if (*fmt == 'x' || *fmt == 'X')
+
+            if (spec.flags & FMT_ALT)
             {
-                itoa(va_arg(args, int), tmp, 16);
-                screen_print(tmp);
+                if (conv == 'o' && (digits == end || *digits != '0'))
+                {
+                    prefix = "0";
+                }
+                else if (conv != 'u' && conv != 'o' && value)
+                {
+                    prefix = conv == 'X' ? "0X" : "0x";
+                }
             }
-            else if (*fmt == 'o')
+            emit_number(out, &spec, digits, end - digits, prefix);
+            break;
+        }
+        case 'p':
+        {
+            uintptr_t value = (uintptr_t) va_arg(*args, void *);
+
+            digits = pow2(end, value, 4, hex_lower);
+            emit_number(out, &spec, digits, end - digits, "0x");
+            break;
+        }
+        case 'c':
+        {
+            char c = (char) va_arg(*args, int);
+            emit_string(out, &spec, &c, 1);
+            break;
+        }
+        case 's':
+        {
+            const char *str = va_arg(*args, const char *);
+            if (!str)
             {
-                utoa(va_arg(args, uint32_t), tmp, 8);
-                screen_print(tmp);
+                str = "(null)";
             }
-            else if (*fmt == 'p')
+
+            if (spec.width == 0 && spec.precision < 0)
             {
-                screen_print("0x");
-                utoa((uint32_t)va_arg(args, void *), tmp, 16);
-                screen_print(tmp);
+                out_copy(out, str, '\0');
+                break;
             }
-            else if (*fmt == '%')
+
+            int32_t len = 0;
+            while (str[len] && (spec.precision < 0 || len < spec.precision))
             {
-                screen_putc('%');
+                len++;
             }
+            emit_string(out, &spec, str, len);
+            break;
         }
-        else
-        {
-            screen_putc(*fmt);
+        case '%':
+            out_write(out, "%", 1);
+            break;
+        default:
+            break;
         }
-        fmt++;
     }
+}
+
+/* ------------------------------------------------------------------ */
+/*  Public interface                                                  */
+/* ------------------------------------------------------------------ */
+
+/**
+ * @brief Format into a buffer.
+ *
+ * @param buf  Destination; always NUL-terminated if @p size > 0.
+ * @param size Size of @p buf in bytes, including the NUL.
+ * @param fmt  Format string (see CONVERSIONS above).
+ * @param args Arguments for @p fmt.
+ *
+ * @return Length of the full result, excluding the NUL. A value of
+ *         @p size or more means the output was truncated.
+ */
+int kvsnprintf(char *buf, size_t size, const char *fmt, va_list args)
+{
+    fmt_out_t out = { buf, size ? size - 1 : 0, 0, 0, NULL };
+    va_list ap;
+
+    va_copy(ap, args);
+    format(&out, fmt, &ap);
+    va_end(ap);
+
+    if (size)
+    {
+        buf[out.len] = '\0';
+    }
+    return (int) out.total;
+}
+
+/**
+ * @brief Format into a buffer (variadic form of kvsnprintf()).
+ */
+int ksnprintf(char *buf, size_t size, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int len = kvsnprintf(buf, size, fmt, args);
+    va_end(args);
+    return len;
+}
+
+/**
+ * @brief Print to the console.
+ *
+ * The output is built on the stack and handed to screen_write() and
+ * serial_write() in one piece (in KPRINTF_BUFFER chunks if it is
+ * longer).
+ */
+void kvprintf(const char *fmt, va_list args)
+{
+    char buf[KPRINTF_BUFFER];
+    fmt_out_t out = { buf, sizeof(buf), 0, 0, console_flush };
+    va_list ap;
+
+    if (!fmt)
+    {
+        return;
+    }
+
+    va_copy(ap, args);
+    format(&out, fmt, &ap);
+    va_end(ap);
 
+    if (out.len)
+    {
+        console_flush(&out);
+    }
+}
+
+void kprintf(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    kvprintf(fmt, args);
     va_end(args);
-}
\ No newline at end of file
+}
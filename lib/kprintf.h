@@ -1,6 +1,12 @@
 #ifndef PRINTF_H_
 #define PRINTF_H_
 
-void kprintf(const char *fmt, ...);
+#include <stdarg.h>
+#include <stddef.h>
 
-#endif 
\ No newline at end of file
+void kprintf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+void kvprintf(const char *fmt, va_list args);
+int ksnprintf(char *buf, size_t size, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+int kvsnprintf(char *buf, size_t size, const char *fmt, va_list args);
+
+#endif
@@ -0,0 +1,47 @@
+/**
+ * math.c
+ *
+ * 64-bit Arithmetic Helpers
+ *
+ * The kernel is linked without libgcc, so any 64-bit division written
+ * in C (which GCC lowers to a call to __udivdi3 on i386) fails to
+ * link. The helpers here provide the few wide operations the kernel
+ * needs using the native 64-by-32 `divl` instruction.
+ *
+ */
+
+#include "math.h"
+
+/**
+ * @brief Divide an unsigned 64-bit value by an unsigned 32-bit value.
+ *
+ * Performs schoolbook long division in two `divl` steps: the high word
+ * is divided first, and its remainder becomes the upper half of the
+ * second dividend. Each step's quotient is guaranteed to fit in 32
+ * bits, so `divl` never faults.
+ *
+ * @param dividend   The 64-bit value to divide.
+ * @param divisor    The 32-bit divisor. Must not be zero.
+ * @param remainder  Optional output for the remainder (may be NULL).
+ *
+ * @return The 64-bit quotient.
+ */
+uint64_t udivmod64(uint64_t dividend, uint32_t divisor, uint32_t *remainder)
+{
+    uint32_t high = (uint32_t)(dividend >> 32);
+    uint32_t low = (uint32_t)dividend;
+    uint32_t quot_high = high / divisor;
+    uint32_t quot_low;
+    uint32_t rem = high % divisor;
+
+    __asm__ ("divl %4"
+             : "=a"(quot_low), "=d"(rem)
+             : "a"(low), "d"(rem), "rm"(divisor));
+
+    if (remainder)
+    {
+        *remainder = rem;
+    }
+
+    return ((uint64_t)quot_high << 32) | quot_low;
+}
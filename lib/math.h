@@ -0,0 +1,9 @@
+#ifndef MATH_H_
+#define MATH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+uint64_t udivmod64(uint64_t dividend, uint32_t divisor, uint32_t *remainder);
+
+#endif
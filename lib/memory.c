@@ -1,6 +1,70 @@
+/**
+ * memory.c
+ *
+ * Memory Block Operations
+ *
+ * memcpy/memmove/memset/memset16/memcmp come in several variants,
+ * collected in one memory_ops_t table per implementation. The public
+ * functions forward through `memory_ops`, which memory_select() points
+ * at one of the tables once at boot.
+ *
+ * --------------------------------------------------------------------
+ * VARIANTS
+ * --------------------------------------------------------------------
+ *
+ *   MEMORY_IMPL_BYTE  Plain C byte loops. Kept as the reference and as
+ *                     the baseline for the boot benchmark.
+ *
+ *   MEMORY_IMPL_REP   `rep movsd` / `rep stosd` for the bulk and
+ *                     `rep movsb` / `rep stosb` for the 0-3 byte tail.
+ *                     memcmp compares a 32-bit word at a time and only
+ *                     drops to bytes inside the first differing word.
+ *                     Works on every i386; this is the default.
+ *
+ *   MEMORY_IMPL_SSE2  16-byte SSE2 loads/stores, 64 bytes per loop
+ *                     iteration, with the destination aligned first.
+ *                     Short blocks (< MEMORY_SSE2_MIN) use the REP code.
+ *
+ * --------------------------------------------------------------------
+ * OVERLAP
+ * --------------------------------------------------------------------
+ *
+ * memmove copies forward whenever that is safe (dest below src, or no
+ * overlap) and falls back to a backward `std; rep movs` copy when dest
+ * overlaps the tail of src. A forward copy in chunks is safe for
+ * dest < src because every chunk is read before it is written, and the
+ * write lands below the next chunk's source.
+ *
+ * --------------------------------------------------------------------
+ * SSE2 AND INTERRUPTS
+ * --------------------------------------------------------------------
+ *
+ * The kernel is compiled without SSE, so the compiler never keeps
+ * values in XMM registers and the asm blocks below don't declare them
+ * as clobbered (GCC refuses XMM clobbers for a non-SSE target).
+ *
+ * An interrupt handler may itself call memmove (printing scrolls the
+ * screen) in the middle of an SSE2 copy. The SSE2 table may therefore
+ * only be selected once SSE is enabled and XMM state is preserved
+ * across interrupts, which kernel/fpu.c does lazily through #NM.
+ *
+ * All variants assume EFLAGS.DF is clear on entry, as the C ABI
+ * requires; the interrupt stubs clear it before calling into C.
+ *
+ */
+
 #include "memory.h"
 
-void *memcpy(void *dest, const void *src, size_t n)
+#define MEMORY_SSE2_MIN 64              // Below this the REP variant is faster
+
+// 32-bit load that is allowed to alias anything (used by memcmp)
+typedef uint32_t __attribute__((may_alias)) word_alias_t;
+
+/* ------------------------------------------------------------------ */
+/*  Byte loops (reference)                                            */
+/* ------------------------------------------------------------------ */
+
+static void *memcpy_byte(void *dest, const void *src, size_t n)
 {
     unsigned char *d = (unsigned char *) dest;
     const unsigned char *s = (const unsigned char *) src;
@@ -13,7 +77,7 @@ void *memcpy(void *dest, const void *src, size_t n)
     return dest;
 }
 
-void *memmove(void *dest, const void *src, size_t n)
+static void *memmove_byte(void *dest, const void *src, size_t n)
 {
     unsigned char *d = (unsigned char *) dest;
     const unsigned char *s = (const unsigned char *) src;
@@ -43,7 +107,7 @@ void *memmove(void *dest, const void *src, size_t n)
     return dest;
 }
 
-void *memset(void *dest, int val, size_t n)
+static void *memset_byte(void *dest, int val, size_t n)
 {
     unsigned char *temp = (unsigned char *) dest;
     unsigned char v = (unsigned char) val; // truncate value
@@ -56,7 +120,7 @@ void *memset(void *dest, int val, size_t n)
     return dest;
 }
 
-void *memset16(void *dest, uint16_t val, size_t n)
+static void *memset16_byte(void *dest, uint16_t val, size_t n)
 {
     uint16_t *temp = (uint16_t *) dest;
 
@@ -68,7 +132,7 @@ void *memset16(void *dest, uint16_t val, size_t n)
     return dest;
 }
 
-int memcmp(const void *s1, const void *s2, size_t n)
+static int memcmp_byte(const void *s1, const void *s2, size_t n)
 {
     const unsigned char *sc1 = (const unsigned char *) s1;
     const unsigned char *sc2 = (const unsigned char *) s2;
@@ -83,4 +147,386 @@ int memcmp(const void *s1, const void *s2, size_t n)
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+/* ------------------------------------------------------------------ */
+/*  REP string instructions                                           */
+/* ------------------------------------------------------------------ */
+
+static void *memcpy_rep(void *dest, const void *src, size_t n)
+{
+    size_t dwords = n >> 2;
+    size_t bytes = n & 3;
+    void *d = dest;
+
+    __asm__ volatile ("rep movsl"
+                      : "+D"(d), "+S"(src), "+c"(dwords)
+                      :
+                      : "memory");
+    __asm__ volatile ("rep movsb"
+                      : "+D"(d), "+S"(src), "+c"(bytes)
+                      :
+                      : "memory");
+
+    return dest;
+}
+
+/**
+ * @brief Copy backwards, for a dest that overlaps the tail of src.
+ *
+ * The odd bytes at the end go first, then whole dwords down to the
+ * start. DF is set only for the duration of the two string moves.
+ */
+static void memmove_rep_backward(void *dest, const void *src, size_t n)
+{
+    size_t dwords = n >> 2;
+    size_t bytes = n & 3;
+    unsigned char *d = (unsigned char *) dest + n - 1;
+    const unsigned char *s = (const unsigned char *) src + n - 1;
+
+    __asm__ volatile ("std\n\t"
+                      "rep movsb\n\t"
+                      "sub $3, %%edi\n\t"
+                      "sub $3, %%esi\n\t"
+                      "mov %3, %%ecx\n\t"
+                      "rep movsl\n\t"
+                      "cld"
+                      : "+D"(d), "+S"(s), "+c"(bytes)
+                      : "r"(dwords)
+                      : "memory", "cc");
+}
+
+static void *memmove_rep(void *dest, const void *src, size_t n)
+{
+    uintptr_t d = (uintptr_t) dest;
+    uintptr_t s = (uintptr_t) src;
+
+    if (d == s || n == 0)
+    {
+        return dest;
+    }
+
+    if (d < s || d >= s + n)
+    {
+        return memcpy_rep(dest, src, n);
+    }
+
+    memmove_rep_backward(dest, src, n);
+    return dest;
+}
+
+static void *memset_rep(void *dest, int val, size_t n)
+{
+    uint32_t pattern = (uint8_t) val * 0x01010101u;
+    size_t dwords = n >> 2;
+    size_t bytes = n & 3;
+    void *d = dest;
+
+    __asm__ volatile ("rep stosl"
+                      : "+D"(d), "+c"(dwords)
+                      : "a"(pattern)
+                      : "memory");
+    __asm__ volatile ("rep stosb"
+                      : "+D"(d), "+c"(bytes)
+                      : "a"(pattern)
+                      : "memory");
+
+    return dest;
+}
+
+static void *memset16_rep(void *dest, uint16_t val, size_t n)
+{
+    uint32_t pattern = ((uint32_t) val << 16) | val;
+    size_t dwords = n >> 1;
+    size_t words = n & 1;
+    void *d = dest;
+
+    __asm__ volatile ("rep stosl"
+                      : "+D"(d), "+c"(dwords)
+                      : "a"(pattern)
+                      : "memory");
+    __asm__ volatile ("rep stosw"
+                      : "+D"(d), "+c"(words)
+                      : "a"(pattern)
+                      : "memory");
+
+    return dest;
+}
+
+static int memcmp_word(const void *s1, const void *s2, size_t n)
+{
+    const unsigned char *sc1 = (const unsigned char *) s1;
+    const unsigned char *sc2 = (const unsigned char *) s2;
+
+    // Skip equal words; the first differing one is resolved bytewise below
+    while (n >= 4 && *(const word_alias_t *) sc1 == *(const word_alias_t *) sc2)
+    {
+        sc1 += 4;
+        sc2 += 4;
+        n -= 4;
+    }
+
+    return memcmp_byte(sc1, sc2, n);
+}
+
+/* ------------------------------------------------------------------ */
+/*  SSE2                                                              */
+/* ------------------------------------------------------------------ */
+
+/**
+ * @brief Forward SSE2 copy of whole 64-byte blocks.
+ *
+ * @p d must be 16-byte aligned; @p s may be unaligned.
+ */
+static void sse2_copy_blocks(unsigned char *d, const unsigned char *s, size_t blocks)
+{
+    if (blocks == 0)
+    {
+        return;
+    }
+
+    __asm__ volatile ("1:\n\t"
+                      "movdqu   (%1), %%xmm0\n\t"
+                      "movdqu 16(%1), %%xmm1\n\t"
+                      "movdqu 32(%1), %%xmm2\n\t"
+                      "movdqu 48(%1), %%xmm3\n\t"
+                      "movdqa %%xmm0,   (%0)\n\t"
+                      "movdqa %%xmm1, 16(%0)\n\t"
+                      "movdqa %%xmm2, 32(%0)\n\t"
+                      "movdqa %%xmm3, 48(%0)\n\t"
+                      "add $64, %1\n\t"
+                      "add $64, %0\n\t"
+                      "dec %2\n\t"
+                      "jnz 1b"
+                      : "+r"(d), "+r"(s), "+r"(blocks)
+                      :
+                      : "memory", "cc");
+}
+
+/**
+ * @brief Forward copy: align dest, SSE2 blocks, REP tail.
+ *
+ * Also used by memmove for dest < src (see OVERLAP above).
+ */
+static void *memcpy_sse2(void *dest, const void *src, size_t n)
+{
+    unsigned char *d = (unsigned char *) dest;
+    const unsigned char *s = (const unsigned char *) src;
+
+    if (n < MEMORY_SSE2_MIN)
+    {
+        return memcpy_rep(dest, src, n);
+    }
+
+    size_t head = (16 - ((uintptr_t) d & 15)) & 15;
+    memcpy_rep(d, s, head);
+    d += head;
+    s += head;
+    n -= head;
+
+    sse2_copy_blocks(d, s, n >> 6);
+
+    size_t done = n & ~(size_t) 63;
+    memcpy_rep(d + done, s + done, n - done);
+
+    return dest;
+}
+
+static void *memmove_sse2(void *dest, const void *src, size_t n)
+{
+    uintptr_t d = (uintptr_t) dest;
+    uintptr_t s = (uintptr_t) src;
+
+    if (d == s || n == 0)
+    {
+        return dest;
+    }
+
+    if (d < s || d >= s + n)
+    {
+        return memcpy_sse2(dest, src, n);
+    }
+
+    memmove_rep_backward(dest, src, n);
+    return dest;
+}
+
+/**
+ * @brief Fill whole 64-byte blocks with a 32-bit pattern.
+ *
+ * @p d must be 16-byte aligned.
+ */
+static void sse2_fill_blocks(unsigned char *d, uint32_t pattern, size_t blocks)
+{
+    if (blocks == 0)
+    {
+        return;
+    }
+
+    __asm__ volatile ("movd %2, %%xmm0\n\t"
+                      "pshufd $0, %%xmm0, %%xmm0\n\t"
+                      "1:\n\t"
+                      "movdqa %%xmm0,   (%0)\n\t"
+                      "movdqa %%xmm0, 16(%0)\n\t"
+                      "movdqa %%xmm0, 32(%0)\n\t"
+                      "movdqa %%xmm0, 48(%0)\n\t"
+                      "add $64, %0\n\t"
+                      "dec %1\n\t"
+                      "jnz 1b"
+                      : "+r"(d), "+r"(blocks)
+                      : "r"(pattern)
+                      : "memory", "cc");
+}
+
+static void *memset_sse2(void *dest, int val, size_t n)
+{
+    unsigned char *d = (unsigned char *) dest;
+
+    if (n < MEMORY_SSE2_MIN)
+    {
+        return memset_rep(dest, val, n);
+    }
+
+    size_t head = (16 - ((uintptr_t) d & 15)) & 15;
+    memset_rep(d, val, head);
+    d += head;
+    n -= head;
+
+    sse2_fill_blocks(d, (uint8_t) val * 0x01010101u, n >> 6);
+
+    size_t done = n & ~(size_t) 63;
+    memset_rep(d + done, val, n - done);
+
+    return dest;
+}
+
+static void *memset16_sse2(void *dest, uint16_t val, size_t n)
+{
+    unsigned char *d = (unsigned char *) dest;
+
+    // An odd address can never reach 16-byte alignment in whole words
+    if (n * 2 < MEMORY_SSE2_MIN || ((uintptr_t) d & 1))
+    {
+        return memset16_rep(dest, val, n);
+    }
+
+    size_t head = ((16 - ((uintptr_t) d & 15)) & 15) / 2;
+    memset16_rep(d, val, head);
+    d += head * 2;
+    n -= head;
+
+    sse2_fill_blocks(d, ((uint32_t) val << 16) | val, n >> 5);
+
+    size_t done = n & ~(size_t) 31;
+    memset16_rep(d + done * 2, val, n - done);
+
+    return dest;
+}
+
+static int memcmp_sse2(const void *s1, const void *s2, size_t n)
+{
+    const unsigned char *sc1 = (const unsigned char *) s1;
+    const unsigned char *sc2 = (const unsigned char *) s2;
+
+    if (n < MEMORY_SSE2_MIN)
+    {
+        return memcmp_word(s1, s2, n);
+    }
+
+    // Skip equal 16-byte chunks; the first differing one is resolved below
+    size_t chunks = n >> 4;
+    __asm__ volatile ("1:\n\t"
+                      "movdqu (%0), %%xmm0\n\t"
+                      "movdqu (%1), %%xmm1\n\t"
+                      "pcmpeqb %%xmm1, %%xmm0\n\t"
+                      "pmovmskb %%xmm0, %%eax\n\t"
+                      "cmp $0xFFFF, %%eax\n\t"
+                      "jne 2f\n\t"
+                      "add $16, %0\n\t"
+                      "add $16, %1\n\t"
+                      "dec %2\n\t"
+                      "jnz 1b\n\t"
+                      "2:"
+                      : "+r"(sc1), "+r"(sc2), "+r"(chunks)
+                      :
+                      : "eax", "memory", "cc");
+
+    n -= sc1 - (const unsigned char *) s1;
+    return memcmp_word(sc1, sc2, n);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Dispatch                                                          */
+/* ------------------------------------------------------------------ */
+
+static const memory_ops_t memory_impls[MEMORY_IMPL_COUNT] = {
+    [MEMORY_IMPL_BYTE] = { "byte", memcpy_byte, memmove_byte, memset_byte, memset16_byte, memcmp_byte },
+    [MEMORY_IMPL_REP]  = { "rep",  memcpy_rep,  memmove_rep,  memset_rep,  memset16_rep,  memcmp_word },
+    [MEMORY_IMPL_SSE2] = { "sse2", memcpy_sse2, memmove_sse2, memset_sse2, memset16_sse2, memcmp_sse2 },
+};
+
+// REP works on any i386, so it is safe before memory_select() runs
+static const memory_ops_t *memory_ops = &memory_impls[MEMORY_IMPL_REP];
+
+/**
+ * @brief Choose the implementation behind memcpy() and friends.
+ *
+ * Called once during boot, before interrupts are enabled.
+ *
+ * @param impl Variant to use. The caller must have checked that the
+ *             CPU supports it (and, for SSE2, that SSE is enabled).
+ */
+void memory_select(memory_impl_t impl)
+{
+    if (impl < MEMORY_IMPL_COUNT)
+    {
+        memory_ops = &memory_impls[impl];
+    }
+}
+
+/**
+ * @brief Get the operations table of one implementation.
+ *
+ * Lets benchmarks call a specific variant regardless of the selection.
+ *
+ * @param impl Variant to look up.
+ *
+ * @return The table, or NULL if @p impl is out of range.
+ */
+const memory_ops_t *memory_get_ops(memory_impl_t impl)
+{
+    return impl < MEMORY_IMPL_COUNT ? &memory_impls[impl] : NULL;
+}
+
+/**
+ * @brief Get the name of the selected implementation.
+ */
+const char *memory_selected_name(void)
+{
+    return memory_ops->name;
+}
+
+void *memcpy(void *dest, const void *src, size_t n)
+{
+    return memory_ops->memcpy(dest, src, n);
+}
+
+void *memmove(void *dest, const void *src, size_t n)
+{
+    return memory_ops->memmove(dest, src, n);
+}
+
+void *memset(void *dest, int val, size_t n)
+{
+    return memory_ops->memset(dest, val, n);
+}
+
+void *memset16(void *dest, uint16_t val, size_t n)
+{
+    return memory_ops->memset16(dest, val, n);
+}
+
+int memcmp(const void *s1, const void *s2, size_t n)
+{
+    return memory_ops->memcmp(s1, s2, n);
+}
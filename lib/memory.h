@@ -4,10 +4,30 @@
 #include <stddef.h>
 #include <stdint.h>
 
+typedef enum {
+    MEMORY_IMPL_BYTE = 0,               // Plain C byte loops (reference)
+    MEMORY_IMPL_REP,                    // rep movsd/stosd, word memcmp (default)
+    MEMORY_IMPL_SSE2,                   // 16-byte SSE2 loops; needs SSE enabled (fpu_init)
+    MEMORY_IMPL_COUNT
+} memory_impl_t;
+
+typedef struct {
+    const char *name;
+    void *(*memcpy)(void *dest, const void *src, size_t n);
+    void *(*memmove)(void *dest, const void *src, size_t n);
+    void *(*memset)(void *dest, int val, size_t n);
+    void *(*memset16)(void *dest, uint16_t val, size_t n);
+    int (*memcmp)(const void *s1, const void *s2, size_t n);
+} memory_ops_t;
+
 void *memcpy(void *dest, const void *src, size_t n);
 void *memmove(void *dest, const void *src, size_t n);
 void *memset(void *dest, int val, size_t n);
 void *memset16(void *dest, uint16_t val, size_t n);
 int memcmp(const void *s1, const void *s2, size_t n);
 
-#endif
\ No newline at end of file
+void memory_select(memory_impl_t impl);
+const memory_ops_t *memory_get_ops(memory_impl_t impl);
+const char *memory_selected_name(void);
+
+#endif
@@ -3,8 +3,9 @@
  *
  * String Conversion Utilities
  *
- * This file provides integer-to-string conversion functions for use
- * in a freestanding (no libc) environment.
+ * This file provides integer-to-string conversion functions, plus the
+ * few C string helpers the kernel needs, for use in a freestanding
+ * (no libc) environment.
  *
  * --------------------------------------------------------------------
  * CONVERSION APPROACH
@@ -128,3 +129,39 @@ char *itoa(int32_t value, char *buf, int base)
     utoa((uint32_t)value, buf, base);
     return buf;
 }
+
+/**
+ * @brief Get the length of a NUL-terminated string.
+ *
+ * @param s String to measure.
+ *
+ * @return Number of characters before the terminating NUL.
+ */
+size_t strlen(const char *s)
+{
+    size_t n = 0;
+    while (s[n])
+    {
+        n++;
+    }
+    return n;
+}
+
+/**
+ * @brief Compare two NUL-terminated strings.
+ *
+ * @param s1 First string.
+ * @param s2 Second string.
+ *
+ * @return Negative, zero or positive as @p s1 sorts before, equal to
+ *         or after @p s2 (bytes compared as unsigned char).
+ */
+int strcmp(const char *s1, const char *s2)
+{
+    while (*s1 && *s1 == *s2)
+    {
+        s1++;
+        s2++;
+    }
+    return (unsigned char)*s1 - (unsigned char)*s2;
+}
@@ -6,5 +6,7 @@
 
 char *itoa(int32_t value, char *buf, int base);
 char *utoa(uint32_t value, char *buf, int base);
+size_t strlen(const char *s);
+int strcmp(const char *s1, const char *s2);
 
 #endif